@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "cube.h"
+#include "scramble.h"
+#include "solution_cache.h"
+#include "solver.h"
+#include "state_hash.h"
+#include "thread_pool.h"
+
+// Headless batch mode: every input line is a scramble, every output line is
+// the resulting state as 54 face letters (face order F B R L U D, stickers in
+// CubeState order) and, when solving, a tab and the solution.
+struct BatchOptions {
+    enum Solver { NONE, TWO_PHASE, OPTIMAL } solver = NONE;
+    int threads = 0;
+    size_t cacheEntries = 0;        // solution cache size; 0 solves every line
+    const char* then = nullptr;     // algorithm applied after every line's moves
+    const char* input = nullptr;    // stdin when null
+    // Scramble generation instead of processing input
+    long long generate = 0;         // number of scrambles to write
+    int length = 25;                // moves per scramble
+    bool randomState = false;       // scrambles to uniformly random states
+    uint64_t seed = 0;              // 0 picks a random seed
+};
+
+const size_t BATCH_LINE_OUTPUT = 54 + 1 + 31 * 3 + 1;   // state, tab, solution, newline
+const int MAX_GENERATE_LENGTH = 31;      // longest --length; generated lines hold at most 31 moves
+const size_t BATCH_CHUNK_BYTES = 1 << 22;
+const size_t BATCH_LINES_PER_TASK = 256;
+
+// Process one input line into a fixed-size output slot. then, when given,
+// is applied after the line's moves.
+static size_t processBatchLine(const char* line, const char* end, const BatchOptions& options,
+                               const MovePlan* then, SolutionCache* cache, char* out) {
+    static thread_local std::vector<int> moves;
+    const char* p = line;
+    if (!parseAlgorithm(p, end, moves)) {
+        return snprintf(out, BATCH_LINE_OUTPUT, "error: invalid move at column %d\n", (int)(p - line) + 1);
+    }
+    CubeState state = solvedCubeState();
+    applyMoves(state, moves.data(), moves.size());
+    if (then) applyPlan(state, *then);
+    char* o = out;
+    for (int i = 0; i < 54; i++) *o++ = faceLetters[state.sticker[i]];
+    if (options.solver != BatchOptions::NONE) {
+        // Solve as seen from the cube's current orientation
+        normalizeCenters(state);
+        static thread_local std::vector<int> solution;
+        auto solver = [&](const CubeState& s, std::vector<int>& result) {
+            return options.solver == BatchOptions::OPTIMAL ? solve(s, result) : solveTwoPhase(s, result);
+        };
+        bool solved = cache ? solveCached(*cache, state, solution, solver) : solver(state, solution);
+        *o++ = '\t';
+        if (solved && solution.size() <= 31) {
+            o += formatMoves(solution.data(), solution.size(), o);
+        } else {
+            memcpy(o, "unsolved", 8);
+            o += 8;
+        }
+    }
+    *o++ = '\n';
+    return o - out;
+}
+
+// Stream scrambles through the batch pipeline. Input is read in large chunks,
+// the complete lines of a chunk are processed in parallel into fixed output
+// slots, and the slots are written in input order. Buffers are reused from
+// chunk to chunk, so steady-state processing does not allocate.
+static int runBatch(const BatchOptions& options) {
+    FILE* in = options.input ? fopen(options.input, "rb") : stdin;
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", options.input);
+        return 1;
+    }
+    initMoveTables();
+    MovePlan thenPlan;
+    if (options.then) {
+        const char* p = options.then;
+        if (!compileAlgorithm(p, p + strlen(p), thenPlan)) {
+            fprintf(stderr, "--then: invalid move at column %d\n", (int)(p - options.then) + 1);
+            return 1;
+        }
+    }
+    if (options.solver == BatchOptions::TWO_PHASE) initTwoPhase();
+    if (options.solver == BatchOptions::OPTIMAL) initSolver();
+    std::unique_ptr<SolutionCache> cache;
+    if (options.solver != BatchOptions::NONE && options.cacheEntries > 0) {
+        initSymmetries();
+        cache.reset(new SolutionCache(options.cacheEntries));
+    }
+    WorkStealingPool pool(options.threads);
+    static char outputBuffer[1 << 20];
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+    std::vector<char> buffer(BATCH_CHUNK_BYTES);
+    std::vector<const char*> lineStart;
+    std::vector<char> output;
+    std::vector<size_t> outputLength;
+    size_t carried = 0;
+    bool eof = false;
+    while (!eof || carried > 0) {
+        size_t got = eof ? 0 : fread(buffer.data() + carried, 1, buffer.size() - carried, in);
+        if (got == 0) eof = true;
+        size_t filled = carried + got;
+        // Complete lines only; the unterminated tail waits for the next read
+        // unless the input has ended
+        size_t usable = filled;
+        if (!eof) {
+            while (usable > 0 && buffer[usable - 1] != '\n') usable--;
+            if (usable == 0) {
+                // A line longer than the buffer: grow and read again
+                carried = filled;
+                if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+                continue;
+            }
+        }
+        lineStart.clear();
+        for (size_t i = 0; i < usable;) {
+            lineStart.push_back(buffer.data() + i);
+            const char* nl = (const char*)memchr(buffer.data() + i, '\n', usable - i);
+            i = nl ? nl - buffer.data() + 1 : usable;
+        }
+        lineStart.push_back(buffer.data() + usable);
+        size_t lines = lineStart.size() - 1;
+        if (output.size() < lines * BATCH_LINE_OUTPUT) output.resize(lines * BATCH_LINE_OUTPUT);
+        if (outputLength.size() < lines) outputLength.resize(lines);
+        size_t tasks = (lines + BATCH_LINES_PER_TASK - 1) / BATCH_LINES_PER_TASK;
+        pool.parallelFor(tasks, [&](size_t t) {
+            size_t last = std::min(lines, (t + 1) * BATCH_LINES_PER_TASK);
+            for (size_t i = t * BATCH_LINES_PER_TASK; i < last; i++) {
+                const char* end = lineStart[i + 1];
+                if (end > lineStart[i] && end[-1] == '\n') end--;
+                outputLength[i] = processBatchLine(lineStart[i], end, options, options.then ? &thenPlan : nullptr, cache.get(),
+                                                 output.data() + i * BATCH_LINE_OUTPUT);
+            }
+        });
+        for (size_t i = 0; i < lines; i++) {
+            fwrite(output.data() + i * BATCH_LINE_OUTPUT, 1, outputLength[i], stdout);
+        }
+        carried = filled - usable;
+        memmove(buffer.data(), buffer.data() + usable, carried);
+        if (eof) break;
+    }
+    fflush(stdout);
+    if (in != stdin) fclose(in);
+    if (cache) {
+        SolutionCache::Stats stats = cache->stats();
+        uint64_t lookups = stats.hits + stats.misses;
+        fprintf(stderr, "cache: %llu hits, %llu misses (%.1f%% hit rate), %llu insertions, %llu evictions, %zu entries\n",
+                (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+                lookups ? 100.0 * stats.hits / lookups : 0.0,
+                (unsigned long long)stats.insertions, (unsigned long long)stats.evictions, cache->capacity());
+    }
+    return 0;
+}
+
+// Write options.generate scrambles, one per line. Lines are generated in
+// parallel blocks; block b always uses the generator seeded with (seed, b),
+// so a given seed reproduces the same corpus on any number of threads.
+static int runGenerate(const BatchOptions& options) {
+    initMoveTables();
+    if (options.randomState) initTwoPhase();
+    WorkStealingPool pool(options.threads);
+    static char outputBuffer[1 << 20];
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+    uint64_t seed = options.seed ? options.seed : threadScrambleRng().next();
+
+    const size_t linesPerTask = options.randomState ? 64 : 4096;
+    const size_t tasksPerRound = 64;
+    size_t lineBytes = (options.randomState ? 31 : options.length) * 3 + 1;
+    std::vector<char> output(tasksPerRound * linesPerTask * lineBytes);
+    std::vector<size_t> outputLength(tasksPerRound * linesPerTask);
+    size_t total = options.generate;
+    for (size_t first = 0; first < total; first += tasksPerRound * linesPerTask) {
+        size_t lines = std::min(total - first, tasksPerRound * linesPerTask);
+        size_t tasks = (lines + linesPerTask - 1) / linesPerTask;
+        pool.parallelFor(tasks, [&](size_t t) {
+            ScrambleRng rng(seed ^ ((first / linesPerTask + t + 1) * 0x9e3779b97f4a7c15ULL));
+            std::vector<int> moves(options.length);
+            size_t last = std::min(lines, (t + 1) * linesPerTask);
+            for (size_t i = t * linesPerTask; i < last; i++) {
+                if (options.randomState) moves = randomStateScramble(rng);
+                else randomScramble(rng, moves.data(), options.length);
+                char* out = output.data() + i * lineBytes;
+                size_t length = formatMoves(moves.data(), std::min<size_t>(moves.size(), MAX_GENERATE_LENGTH), out);
+                out[length] = '\n';
+                outputLength[i] = length + 1;
+            }
+        });
+        for (size_t i = 0; i < lines; i++) fwrite(output.data() + i * lineBytes, 1, outputLength[i], stdout);
+    }
+    fflush(stdout);
+    return 0;
+}
+
+static void printUsage(const char* program) {
+    printf("Usage: %s [options] [file]\n", program);
+    printf("Reads one scramble per line (e.g. R U' F2, or any algorithm with\n");
+    printf("slices, rotations and groups such as [R, U]) from file or stdin and\n");
+    printf("prints the resulting state, optionally with a solution.\n");
+    printf("  --then ALG     apply ALG after every line, compiled to one permutation\n");
+    printf("  --solve        append a fast two-phase solution\n");
+    printf("  --optimal      append an optimal solution (slow)\n");
+    printf("  --threads N    worker threads (default: all cores)\n");
+    printf("  --cache N      cache up to N solutions, shared by symmetric states\n");
+    printf("  --generate N   write N random scrambles instead of reading input\n");
+    printf("  --length L     moves per generated scramble, 0-%d (default 25)\n", MAX_GENERATE_LENGTH);
+    printf("  --random-state generate scrambles to uniformly random states\n");
+    printf("  --seed S       seed for a reproducible corpus\n");
+}
+
+int main(int argc, char** argv) {
+    BatchOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--solve") == 0) options.solver = BatchOptions::TWO_PHASE;
+        else if (strcmp(argv[i], "--optimal") == 0) options.solver = BatchOptions::OPTIMAL;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--then") == 0 && i + 1 < argc) options.then = argv[++i];
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) options.cacheEntries = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) options.generate = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--length") == 0 && i + 1 < argc) options.length = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--random-state") == 0) options.randomState = true;
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) options.seed = strtoull(argv[++i], nullptr, 10);
+        else if (argv[i][0] != '-' && !options.input) options.input = argv[i];
+        else {
+            printUsage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (options.length < 0 || options.length > MAX_GENERATE_LENGTH) {
+        fprintf(stderr, "--length must be between 0 and %d\n", MAX_GENERATE_LENGTH);
+        return 1;
+    }
+    return options.generate > 0 ? runGenerate(options) : runBatch(options);
+}
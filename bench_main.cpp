@@ -0,0 +1,405 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "cube.h"
+#include "cube_env.h"
+#include "cube_nxn.h"
+#include "cube_picking.h"
+#include "frame_profiler.h"
+#include "scramble.h"
+#include "solution_cache.h"
+#include "state_hash.h"
+
+#ifdef RUBIKS_BENCH_RENDER
+#include <GL/gl.h>
+
+#include "cube_renderer.h"
+#include "cube_scene.h"
+#include "offscreen.h"
+#endif
+
+// Microbenchmarks for the hot paths of the model and the renderers. Results
+// are machine readable with the usual Google Benchmark flags, e.g.
+//   rubiks_bench --benchmark_format=json --benchmark_out=bench.json
+// Items per second are moves, states or frames depending on the benchmark.
+
+// A fixed pseudo-random move sequence, the same on every run
+static std::vector<int> benchMoves(size_t count) {
+    std::vector<int> moves(count);
+    unsigned seed = 12345;
+    for (int& move : moves) move = rand_r(&seed) % MOVE_COUNT;
+    return moves;
+}
+
+// Reference sticker-array face turn the move tables are generated from
+static void BM_ReferenceTurn(benchmark::State& bench) {
+    int state[6][9];
+    fromCubeState(solvedCubeState(), state);
+    int face = 0;
+    for (auto _ : bench) {
+        performFaceRotation(state, face);
+        face = face == 5 ? 0 : face + 1;
+        benchmark::DoNotOptimize(state);
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_ReferenceTurn);
+
+static void BM_ApplyMove(benchmark::State& bench) {
+    initMoveTables();
+    std::vector<int> moves = benchMoves(1024);
+    CubeState state = solvedCubeState();
+    size_t i = 0;
+    for (auto _ : bench) {
+        applyMove(state, moves[i++ & 1023]);
+        benchmark::DoNotOptimize(state);
+    }
+    bench.SetItemsProcessed(bench.iterations());
+    bench.SetLabel(moveKernel.name);
+}
+BENCHMARK(BM_ApplyMove);
+
+// A sequence of range(0) moves applied one by one to one state
+static void BM_ApplyMoves(benchmark::State& bench) {
+    initMoveTables();
+    std::vector<int> moves = benchMoves(bench.range(0));
+    CubeState state = solvedCubeState();
+    for (auto _ : bench) {
+        applyMoves(state, moves.data(), moves.size());
+        benchmark::DoNotOptimize(state);
+    }
+    bench.SetItemsProcessed(bench.iterations() * moves.size());
+}
+BENCHMARK(BM_ApplyMoves)->Arg(20)->Arg(100)->Arg(1000);
+
+// One 20-move sequence applied to a batch of range(0) states; items are
+// moves, so the rate compares directly with BM_ApplyMoves
+static void BM_ApplyMovesBatch(benchmark::State& bench) {
+    initMoveTables();
+    std::vector<int> moves = benchMoves(20);
+    std::vector<CubeState> states(bench.range(0), solvedCubeState());
+    for (auto _ : bench) {
+        applyMovesBatch(states.data(), states.size(), moves.data(), moves.size());
+        benchmark::ClobberMemory();
+    }
+    bench.SetItemsProcessed(bench.iterations() * states.size() * moves.size());
+}
+BENCHMARK(BM_ApplyMovesBatch)->Arg(1024)->Arg(65536);
+
+static void BM_ComposeMoves(benchmark::State& bench) {
+    initMoveTables();
+    std::vector<int> moves = benchMoves(20);
+    MovePlan plan;
+    for (auto _ : bench) {
+        composeMoves(plan, moves.data(), moves.size());
+        benchmark::DoNotOptimize(plan);
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_ComposeMoves);
+
+// Random layer turns on an NxN cube with the size fixed at compile time; on
+// the 3x3 the face turns take the move kernels, so compare with BM_ApplyMove
+template <int N>
+static void BM_LayerTurn(benchmark::State& bench) {
+    CubeN<N> cube;
+    std::vector<int> moves(1024);
+    ScrambleRng rng(1);
+    randomLayerScramble(rng, N, moves.data(), moves.size());
+    size_t i = 0;
+    for (auto _ : bench) {
+        cube.apply(moves[i++ & 1023]);
+        benchmark::DoNotOptimize(cube.state());
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK_TEMPLATE(BM_LayerTurn, 2);
+BENCHMARK_TEMPLATE(BM_LayerTurn, 3);
+BENCHMARK_TEMPLATE(BM_LayerTurn, 4);
+BENCHMARK_TEMPLATE(BM_LayerTurn, 7);
+
+// The same on the run-time sized cube
+static void BM_BigCubeTurn(benchmark::State& bench) {
+    BigCube cube(bench.range(0));
+    std::vector<int> moves(1024);
+    ScrambleRng rng(1);
+    randomLayerScramble(rng, cube.size(), moves.data(), moves.size());
+    size_t i = 0;
+    for (auto _ : bench) {
+        cube.apply(moves[i++ & 1023]);
+        benchmark::DoNotOptimize(cube.stickers());
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_BigCubeTurn)->ArgName("size")->Arg(3)->Arg(7)->Arg(33);
+
+// A 100-move algorithm in text, parsed and composed into one permutation
+static void BM_CompileAlgorithm(benchmark::State& bench) {
+    initMoveTables();
+    std::vector<int> moves = benchMoves(100);
+    std::vector<char> text(moves.size() * 3);
+    int length = formatMoves(moves.data(), moves.size(), text.data());
+    MovePlan plan;
+    for (auto _ : bench) {
+        const char* p = text.data();
+        benchmark::DoNotOptimize(compileAlgorithm(p, p + length, plan));
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_CompileAlgorithm);
+
+// A compiled 100-move algorithm applied to a batch of states: one shuffle per
+// state. Items are states; compare with BM_ApplyMoves/100 per state.
+static void BM_ApplyPlan(benchmark::State& bench) {
+    initMoveTables();
+    std::vector<int> moves = benchMoves(100);
+    MovePlan plan;
+    composeMoves(plan, moves.data(), moves.size());
+    std::vector<CubeState> states(1024, solvedCubeState());
+    for (auto _ : bench) {
+        applyPlan(states.data(), states.size(), plan);
+        benchmark::ClobberMemory();
+    }
+    bench.SetItemsProcessed(bench.iterations() * states.size());
+}
+BENCHMARK(BM_ApplyPlan);
+
+static void BM_Scramble(benchmark::State& bench) {
+    Cube cube;
+    unsigned seed = 1;
+    for (auto _ : bench) {
+        cube.reset();
+        cube.scramble(seed++);
+        benchmark::DoNotOptimize(cube.state());
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_Scramble);
+
+static void BM_RandomScramble(benchmark::State& bench) {
+    ScrambleRng rng(1);
+    int moves[25];
+    for (auto _ : bench) {
+        randomScramble(rng, moves, 25);
+        benchmark::DoNotOptimize(moves);
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_RandomScramble);
+
+// Scrambled states generated on every core of the shared pool
+static void BM_GenerateScrambles(benchmark::State& bench) {
+    std::vector<CubeState> states(1 << 20);
+    uint64_t seed = 1;
+    for (auto _ : bench) {
+        generateScrambles(states.data(), states.size(), seed++);
+        benchmark::ClobberMemory();
+    }
+    bench.SetItemsProcessed(bench.iterations() * states.size());
+}
+BENCHMARK(BM_GenerateScrambles)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_RandomCubeState(benchmark::State& bench) {
+    ScrambleRng rng(1);
+    for (auto _ : bench) benchmark::DoNotOptimize(randomCubeState(rng));
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_RandomCubeState);
+
+// Hash of the raw 64-byte state, as a hash table of states would key it
+static void BM_HashState(benchmark::State& bench) {
+    std::vector<CubeState> states(1024);
+    for (size_t i = 0; i < states.size(); i++) {
+        Cube cube;
+        cube.scramble(i + 1);
+        states[i] = cube.state();
+    }
+    std::hash<std::string_view> hash;
+    size_t i = 0;
+    for (auto _ : bench) {
+        const CubeState& state = states[i++ & 1023];
+        benchmark::DoNotOptimize(hash(std::string_view((const char*)state.sticker, sizeof(state.sticker))));
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_HashState);
+
+static void BM_ZobristHash(benchmark::State& bench) {
+    initSymmetries();
+    std::vector<CubeState> states(1024);
+    ScrambleRng rng(1);
+    for (CubeState& state : states) state = randomCubeState(rng);
+    size_t i = 0;
+    for (auto _ : bench) benchmark::DoNotOptimize(zobristHash(states[i++ & 1023]));
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_ZobristHash);
+
+// A move with its incremental hash update; compare with BM_ApplyMove
+static void BM_ApplyMoveHashed(benchmark::State& bench) {
+    initSymmetries();
+    std::vector<int> moves = benchMoves(1024);
+    CubeState state = solvedCubeState();
+    uint64_t hash = zobristHash(state);
+    size_t i = 0;
+    for (auto _ : bench) {
+        applyMoveHashed(state, hash, moves[i++ & 1023]);
+        benchmark::DoNotOptimize(hash);
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_ApplyMoveHashed);
+
+static void BM_Canonicalize(benchmark::State& bench) {
+    initSymmetries();
+    std::vector<CubeState> states(1024);
+    ScrambleRng rng(1);
+    for (CubeState& state : states) state = randomCubeState(rng);
+    size_t i = 0;
+    for (auto _ : bench) {
+        CubeState state = states[i++ & 1023];
+        benchmark::DoNotOptimize(canonicalize(state));
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_Canonicalize);
+
+// Cache hits: every state is cached, so this is canonicalize, hash, probe
+// and the check that the solution solves the state
+static void BM_CacheLookup(benchmark::State& bench) {
+    initSymmetries();
+    SolutionCache cache(1024);
+    std::vector<CubeState> states(1024);
+    ScrambleRng rng(1);
+    for (CubeState& state : states) {
+        int moves[20];
+        randomScramble(rng, moves, 20);
+        state = solvedCubeState();
+        applyMoves(state, moves, 20);
+        std::vector<int> solution(20);
+        for (int i = 0; i < 20; i++) solution[i] = moves[19 - i] / 3 * 3 + 2 - moves[19 - i] % 3;
+        cache.insert(state, solution);
+    }
+    std::vector<int> solution;
+    size_t i = 0;
+    for (auto _ : bench) benchmark::DoNotOptimize(cache.lookup(states[i++ & 1023], solution));
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_CacheLookup);
+
+// Compare against a state that differs in the last sticker, so the whole
+// state is read
+static void BM_CompareStates(benchmark::State& bench) {
+    CubeState a = solvedCubeState(), b = a;
+    b.sticker[53] ^= 1;
+    for (auto _ : bench) {
+        benchmark::DoNotOptimize(a);
+        benchmark::DoNotOptimize(a == b);
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_CompareStates);
+
+// Goal test against the first two layers of a scrambled state
+static void BM_MatchGoal(benchmark::State& bench) {
+    Cube cube;
+    cube.scramble(7);
+    GoalPattern goal;
+    namedGoalPattern("f2l", goal);
+    CubeState state = cube.state();
+    for (auto _ : bench) {
+        benchmark::DoNotOptimize(state);
+        benchmark::DoNotOptimize(matchesGoal(state, goal));
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_MatchGoal);
+
+// One step of a batch of environments, random face turns with a tenth of
+// the environments reset every step; items are environment steps
+static void BM_EnvStep(benchmark::State& bench) {
+    size_t count = bench.range(0);
+    CubeEnvBatch envs(count, 1);
+    envs.reset();
+    std::vector<int> actions(count);
+    std::vector<uint8_t> mask(count);
+    unsigned seed = 12345;
+    for (size_t i = 0; i < count; i++) mask[i] = rand_r(&seed) % 10 == 0;
+    for (auto _ : bench) {
+        for (int& action : actions) action = rand_r(&seed) % MOVE_COUNT;
+        benchmark::DoNotOptimize(envs.step(actions.data()));
+        envs.reset(mask.data());
+    }
+    bench.SetItemsProcessed(bench.iterations() * count);
+}
+BENCHMARK(BM_EnvStep)->Arg(1024)->Arg(65536)->UseRealTime();
+
+// A scoped timer and a counter with profiling off (range(0) of 0) and on
+static void BM_ProfileTimer(benchmark::State& bench) {
+    frameProfiler.setEnabled(bench.range(0) != 0);
+    for (auto _ : bench) {
+        ProfileTimer timer(PROFILE_DRAW_CUBE);
+        profileCount(PROFILE_DRAW_CALLS, 1);
+        benchmark::ClobberMemory();
+    }
+    frameProfiler.setEnabled(false);
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_ProfileTimer)->ArgName("enabled")->Arg(0)->Arg(1);
+
+// A mouse event: the cursor's ray and the sticker under it, for cursor
+// positions swept across the cube in the viewer's default view
+static void BM_PickSticker(benchmark::State& bench) {
+    int n = bench.range(0), hits = 0, i = 0;
+    for (auto _ : bench) {
+        PickRay ray = cameraRay(25.0f, -30.0f, 12.0f, 1000, 800, 300 + i % 400, 200 + i / 400 % 400);
+        StickerPick pick;
+        hits += pickSticker(n, ray, pick);
+        benchmark::DoNotOptimize(pick);
+        i += 37;
+    }
+    benchmark::DoNotOptimize(hits);
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_PickSticker)->ArgName("size")->Arg(3)->Arg(7);
+
+#ifdef RUBIKS_BENCH_RENDER
+// Headless frames through the viewer's scene setup. Every frame draws a new
+// state (so sticker colours are re-uploaded), while range(0) of 1 also reads
+// the frame back as the offscreen renderer does.
+static void BM_RenderFrame(benchmark::State& bench) {
+    const int width = 640, height = 480;
+    OffscreenContext context;
+    if (!context.create(width, height)) {
+        bench.SkipWithError("no EGL context");
+        return;
+    }
+    setupScene();
+    setProjection(width, height);
+    CubeRenderer renderer;
+    renderer.init(colors);
+    std::vector<int> moves = benchMoves(1024);
+    std::vector<uint8_t> pixels;
+    CubeState state = solvedCubeState();
+    size_t i = 0;
+    for (auto _ : bench) {
+        applyMove(state, moves[i++ & 1023]);
+        renderer.update(state);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        applyCamera(25.0f, -30.0f, 12.0f);
+        positionLights();
+        renderer.draw(-1, 0.0f);
+        if (bench.range(0)) context.readPixels(pixels);
+        else glFinish();
+    }
+    bench.SetItemsProcessed(bench.iterations());
+    bench.SetLabel(std::string((const char*)glGetString(GL_RENDERER)));
+}
+BENCHMARK(BM_RenderFrame)->ArgName("readback")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+#endif
+
+BENCHMARK_MAIN();
@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "cube.h"
+#include "state_hash.h"
+
+// Self-check of the move kernels: every kernel the CPU supports must turn
+// states exactly as the reference performFaceRotation for the face turns,
+// and exactly as the scalar tables for every notation move, one state at a
+// time, in batches and over long move sequences. Incremental hashes and
+// symmetry images of moves are checked against the states they describe.
+// Exits non-zero if anything disagrees.
+
+// A state whose stickers are labelled with their own positions, so any
+// misplaced byte shows
+static CubeState labelledState() {
+    CubeState state = {};
+    for (int i = 0; i < 54; i++) state.sticker[i] = i;
+    return state;
+}
+
+static CubeState referenceFaceTurn(int move) {
+    int labels[6][9];
+    for (int i = 0; i < 54; i++) labels[i / 9][i % 9] = i;
+    for (int t = 0; t <= move % 3; t++) performFaceRotation(labels, move / 3);
+    CubeState state = {};
+    for (int i = 0; i < 54; i++) state.sticker[i] = labels[i / 9][i % 9];
+    return state;
+}
+
+static int checkKernel(const MoveKernel& kernel, const MoveKernel& scalar) {
+    int failures = 0;
+    for (int move = 0; move < NOTATION_MOVE_COUNT; move++) {
+        CubeState state = labelledState(), expected = labelledState();
+        kernel.permute(&state, 1, movePlans[move]);
+        scalar.permute(&expected, 1, movePlans[move]);
+        if (move < MOVE_COUNT && expected != referenceFaceTurn(move)) {
+            printf("  scalar table for %s differs from performFaceRotation\n", moveNames[move]);
+            failures++;
+        }
+        if (state != expected) {
+            printf("  %s: %s differs\n", kernel.name, moveNames[move]);
+            failures++;
+        }
+    }
+
+    // Batches of an odd size, each state different, to cover any tail
+    std::vector<CubeState> batch(37), expectedBatch(37);
+    unsigned seed = 1;
+    for (size_t i = 0; i < batch.size(); i++) {
+        batch[i] = labelledState();
+        for (int m = 0; m < (int)i; m++) scalar.permute(&batch[i], 1, movePlans[rand_r(&seed) % NOTATION_MOVE_COUNT]);
+        expectedBatch[i] = batch[i];
+    }
+    for (int move = 0; move < NOTATION_MOVE_COUNT; move++) {
+        kernel.permute(batch.data(), batch.size(), movePlans[move]);
+        scalar.permute(expectedBatch.data(), expectedBatch.size(), movePlans[move]);
+    }
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (batch[i] != expectedBatch[i]) {
+            printf("  %s: batch state %zu differs\n", kernel.name, i);
+            failures++;
+        }
+    }
+
+    // Long sequences through applyMoves, against one scalar turn at a time
+    std::vector<int> moves(1000);
+    for (int& move : moves) move = rand_r(&seed) % NOTATION_MOVE_COUNT;
+    for (int count : {0, 1, 2, 3, 7, 20, 1000}) {
+        CubeState state = labelledState(), expected = labelledState();
+        kernel.applyMoves(state, moves.data(), count);
+        for (int m = 0; m < count; m++) scalar.permute(&expected, 1, movePlans[moves[m]]);
+        if (state != expected) {
+            printf("  %s: applyMoves of %d moves differs\n", kernel.name, count);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// applyMoveHashed must keep the Zobrist hash equal to zobristHash after
+// every notation move, and symmetryMove must commute with every symmetry
+static int checkHashing() {
+    int failures = 0;
+    unsigned seed = 2;
+    CubeState state = solvedCubeState();
+    uint64_t hash = zobristHash(state);
+    for (int i = 0; i < 10000; i++) {
+        int move = rand_r(&seed) % NOTATION_MOVE_COUNT;
+        applyMoveHashed(state, hash, move);
+        if (hash != zobristHash(state)) {
+            printf("  hash after %s differs from zobristHash\n", moveNames[move]);
+            failures++;
+            hash = zobristHash(state);
+        }
+    }
+    for (int symmetry = 0; symmetry < SYMMETRY_COUNT; symmetry++) {
+        for (int move = 0; move < NOTATION_MOVE_COUNT; move++) {
+            CubeState turned = state, mapped = state;
+            applyMove(turned, move);
+            applySymmetry(turned, symmetry);
+            applySymmetry(mapped, symmetry);
+            applyMove(mapped, symmetryMove(symmetry, move));
+            if (turned != mapped) {
+                printf("  symmetry %d: image of %s differs\n", symmetry, moveNames[move]);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+int main() {
+    initMoveTables();
+    initSymmetries();
+    std::vector<MoveKernel> kernels = supportedMoveKernels();
+    int failures = 0;
+    for (const MoveKernel& kernel : kernels) {
+        int kernelFailures = checkKernel(kernel, kernels[0]);
+        printf("%-12s %s\n", kernel.name, kernelFailures ? "FAILED" : "ok");
+        failures += kernelFailures;
+    }
+    int hashFailures = checkHashing();
+    printf("%-12s %s\n", "hashing", hashFailures ? "FAILED" : "ok");
+    failures += hashFailures;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,687 @@
+#include "cube.h"
+#include "cube_nxn.h"
+#include "scramble.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+#include <mutex>
+
+// Rotate a face 90 degrees clockwise in the state array
+void rotateFaceClockwise(int state[6][9], int face) {
+    int temp[9];
+    // Copy current state
+    for (int i = 0; i < 9; i++) {
+        temp[i] = state[face][i];
+    }
+    
+    // Rotate clockwise: map old positions to new positions
+    // 0 1 2    6 3 0
+    // 3 4 5 -> 7 4 1
+    // 6 7 8    8 5 2
+    state[face][0] = temp[6];
+    state[face][1] = temp[3];
+    state[face][2] = temp[0];
+    state[face][3] = temp[7];
+    state[face][4] = temp[4]; // center stays
+    state[face][5] = temp[1];
+    state[face][6] = temp[8];
+    state[face][7] = temp[5];
+    state[face][8] = temp[2];
+}
+
+// Rotate adjacent edges when a face is rotated
+void rotateAdjacentEdges(int state[6][9], int face) {
+    int temp[3];
+    
+    switch (face) {
+        case 0: // Front face - affects Top, Right, Bottom, Left edges
+            // Save top edge
+            temp[0] = state[4][6]; temp[1] = state[4][7]; temp[2] = state[4][8];
+            // Top <- Left
+            state[4][6] = state[3][8]; state[4][7] = state[3][5]; state[4][8] = state[3][2];
+            // Left <- Bottom
+            state[3][2] = state[5][0]; state[3][5] = state[5][1]; state[3][8] = state[5][2];
+            // Bottom <- Right
+            state[5][0] = state[2][6]; state[5][1] = state[2][3]; state[5][2] = state[2][0];
+            // Right <- Top (from temp)
+            state[2][0] = temp[0]; state[2][3] = temp[1]; state[2][6] = temp[2];
+            break;
+            
+        case 1: // Back face - affects Top, Left, Bottom, Right edges
+            // Save top edge
+            temp[0] = state[4][0]; temp[1] = state[4][1]; temp[2] = state[4][2];
+            // Top <- Right
+            state[4][0] = state[2][2]; state[4][1] = state[2][5]; state[4][2] = state[2][8];
+            // Right <- Bottom
+            state[2][2] = state[5][8]; state[2][5] = state[5][7]; state[2][8] = state[5][6];
+            // Bottom <- Left
+            state[5][6] = state[3][0]; state[5][7] = state[3][3]; state[5][8] = state[3][6];
+            // Left <- Top (from temp)
+            state[3][0] = temp[2]; state[3][3] = temp[1]; state[3][6] = temp[0];
+            break;
+            
+        case 2: // Right face - affects Top, Back, Bottom, Front edges
+            // Save top edge
+            temp[0] = state[4][2]; temp[1] = state[4][5]; temp[2] = state[4][8];
+            // Top <- Front
+            state[4][2] = state[0][2]; state[4][5] = state[0][5]; state[4][8] = state[0][8];
+            // Front <- Bottom
+            state[0][2] = state[5][2]; state[0][5] = state[5][5]; state[0][8] = state[5][8];
+            // Bottom <- Back
+            state[5][2] = state[1][6]; state[5][5] = state[1][3]; state[5][8] = state[1][0];
+            // Back <- Top (from temp)
+            state[1][0] = temp[2]; state[1][3] = temp[1]; state[1][6] = temp[0];
+            break;
+            
+        case 3: // Left face - affects Top, Front, Bottom, Back edges
+            // Save top edge
+            temp[0] = state[4][0]; temp[1] = state[4][3]; temp[2] = state[4][6];
+            // Top <- Back
+            state[4][0] = state[1][8]; state[4][3] = state[1][5]; state[4][6] = state[1][2];
+            // Back <- Bottom
+            state[1][2] = state[5][6]; state[1][5] = state[5][3]; state[1][8] = state[5][0];
+            // Bottom <- Front
+            state[5][0] = state[0][0]; state[5][3] = state[0][3]; state[5][6] = state[0][6];
+            // Front <- Top (from temp)
+            state[0][0] = temp[0]; state[0][3] = temp[1]; state[0][6] = temp[2];
+            break;
+            
+        case 4: // Top face - affects Front, Right, Back, Left edges
+            // Save front edge
+            temp[0] = state[0][0]; temp[1] = state[0][1]; temp[2] = state[0][2];
+            // Front <- Right
+            state[0][0] = state[2][0]; state[0][1] = state[2][1]; state[0][2] = state[2][2];
+            // Right <- Back
+            state[2][0] = state[1][0]; state[2][1] = state[1][1]; state[2][2] = state[1][2];
+            // Back <- Left
+            state[1][0] = state[3][0]; state[1][1] = state[3][1]; state[1][2] = state[3][2];
+            // Left <- Front (from temp)
+            state[3][0] = temp[0]; state[3][1] = temp[1]; state[3][2] = temp[2];
+            break;
+            
+        case 5: // Bottom face - affects Front, Left, Back, Right edges
+            // Save front edge
+            temp[0] = state[0][6]; temp[1] = state[0][7]; temp[2] = state[0][8];
+            // Front <- Left
+            state[0][6] = state[3][6]; state[0][7] = state[3][7]; state[0][8] = state[3][8];
+            // Left <- Back
+            state[3][6] = state[1][6]; state[3][7] = state[1][7]; state[3][8] = state[1][8];
+            // Back <- Right
+            state[1][6] = state[2][6]; state[1][7] = state[2][7]; state[1][8] = state[2][8];
+            // Right <- Front (from temp)
+            state[2][6] = temp[0]; state[2][7] = temp[1]; state[2][8] = temp[2];
+            break;
+    }
+}
+
+// Perform a complete face rotation (both face and adjacent edges)
+void performFaceRotation(int state[6][9], int face) {
+    rotateFaceClockwise(state, face);
+    rotateAdjacentEdges(state, face);
+}
+
+// Whether the 64 bytes of a and b agree wherever mask is set: one XOR, AND
+// and OR per 16 bytes, then a single test of the combined difference
+static inline bool maskedEqual(const uint8_t* a, const uint8_t* b, const uint8_t* mask) {
+    __m128i diff = _mm_setzero_si128();
+    for (int c = 0; c < 4; c++) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)a + c), _mm_loadu_si128((const __m128i*)b + c));
+        diff = _mm_or_si128(diff, mask ? _mm_and_si128(x, _mm_loadu_si128((const __m128i*)mask + c)) : x);
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xffff;
+}
+
+bool operator==(const CubeState& a, const CubeState& b) {
+    return maskedEqual(a.sticker, b.sticker, nullptr);
+}
+
+bool operator!=(const CubeState& a, const CubeState& b) {
+    return !(a == b);
+}
+
+// 0xff at every sticker whose next sticker is on the same face. Constant-
+// initialised, so Cubes constructed during static initialisation elsewhere
+// can already use it.
+struct SameFaceMask {
+    alignas(16) uint8_t byte[64];
+};
+static constexpr SameFaceMask makeSameFaceMask() {
+    SameFaceMask mask = {};
+    for (int i = 0; i < 54; i++) mask.byte[i] = i % 9 != 8 ? 0xff : 0;
+    return mask;
+}
+static constexpr SameFaceMask SAME_FACE = makeSameFaceMask();
+
+// Solved in any orientation: every sticker equals the next one on its face,
+// tested for all 64 bytes at once against the state shifted down a byte
+bool isSolved(const CubeState& state) {
+    __m128i v[5];
+    for (int c = 0; c < 4; c++) v[c] = _mm_loadu_si128((const __m128i*)state.sticker + c);
+    v[4] = _mm_setzero_si128();
+    __m128i diff = _mm_setzero_si128();
+    for (int c = 0; c < 4; c++) {
+        __m128i next = _mm_or_si128(_mm_srli_si128(v[c], 1), _mm_slli_si128(v[c + 1], 15));
+        __m128i mask = _mm_load_si128((const __m128i*)SAME_FACE.byte + c);
+        diff = _mm_or_si128(diff, _mm_and_si128(_mm_xor_si128(v[c], next), mask));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xffff;
+}
+
+// Each pattern letter is replaced by the colour of that face's centre in
+// the state, and the result compared with the state under the mask. With
+// SSE2 a letter's colour is selected by one compare per face letter.
+static bool matchesGoalSSE2(const CubeState& state, const GoalPattern& goal) {
+    __m128i centre[6];
+    for (int face = 0; face < 6; face++) centre[face] = _mm_set1_epi8(state.sticker[face * 9 + 4]);
+    __m128i diff = _mm_setzero_si128();
+    for (int c = 0; c < 4; c++) {
+        __m128i pattern = _mm_load_si128((const __m128i*)goal.sticker + c);
+        __m128i expected = _mm_setzero_si128();
+        for (int face = 0; face < 6; face++) {
+            __m128i letter = _mm_cmpeq_epi8(pattern, _mm_set1_epi8(face));
+            expected = _mm_or_si128(expected, _mm_and_si128(letter, centre[face]));
+        }
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)state.sticker + c), expected);
+        diff = _mm_or_si128(diff, _mm_and_si128(x, _mm_load_si128((const __m128i*)goal.mask + c)));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xffff;
+}
+
+// With SSSE3 the six centres are gathered into one register (stickers 4,
+// 13, 22, 31, 40 and 49, from all four chunks) and every pattern chunk is
+// translated by a single pshufb through them
+__attribute__((target("ssse3")))
+static bool matchesGoalSSSE3(const CubeState& state, const GoalPattern& goal) {
+    __m128i v[4];
+    for (int c = 0; c < 4; c++) v[c] = _mm_loadu_si128((const __m128i*)state.sticker + c);
+    const char z = -128;
+    __m128i centres = _mm_or_si128(
+        _mm_or_si128(_mm_shuffle_epi8(v[0], _mm_setr_epi8(4, 13, z, z, z, z, z, z, z, z, z, z, z, z, z, z)),
+                     _mm_shuffle_epi8(v[1], _mm_setr_epi8(z, z, 6, 15, z, z, z, z, z, z, z, z, z, z, z, z))),
+        _mm_or_si128(_mm_shuffle_epi8(v[2], _mm_setr_epi8(z, z, z, z, 8, z, z, z, z, z, z, z, z, z, z, z)),
+                     _mm_shuffle_epi8(v[3], _mm_setr_epi8(z, z, z, z, z, 1, z, z, z, z, z, z, z, z, z, z))));
+    __m128i diff = _mm_setzero_si128();
+    for (int c = 0; c < 4; c++) {
+        __m128i expected = _mm_shuffle_epi8(centres, _mm_load_si128((const __m128i*)goal.sticker + c));
+        __m128i x = _mm_xor_si128(v[c], expected);
+        diff = _mm_or_si128(diff, _mm_and_si128(x, _mm_load_si128((const __m128i*)goal.mask + c)));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xffff;
+}
+
+// Chosen with the move kernel by initMoveTables
+static bool (*matchGoalKernel)(const CubeState& state, const GoalPattern& goal) = matchesGoalSSE2;
+
+bool matchesGoal(const CubeState& state, const GoalPattern& goal) {
+    return matchGoalKernel(state, goal);
+}
+
+bool parseGoalPattern(const char* text, GoalPattern& goal) {
+    memset(&goal, 0, sizeof(goal));
+    for (int i = 0; i < 54; i++) {
+        if (text[i] == '.') continue;
+        const char* letter = text[i] ? strchr(faceLetters, text[i]) : nullptr;
+        if (!letter) return false;
+        goal.sticker[i] = letter - faceLetters;
+        goal.mask[i] = 0xff;
+    }
+    return text[54] == '\0';
+}
+
+bool namedGoalPattern(const char* name, GoalPattern& goal) {
+    // Faces F B R L U D; side faces have their bottom row (6-8) on D
+    static const struct {
+        const char* name;
+        const char* pattern;
+    } patterns[] = {
+        {"solved", "FFFFFFFFFBBBBBBBBBRRRRRRRRRLLLLLLLLLUUUUUUUUUDDDDDDDDD"},
+        {"cross", "....F..F.....B..B.....R..R.....L..L...........D.DDD.D."},
+        {"first-layer", "....F.FFF....B.BBB....R.RRR....L.LLL.........DDDDDDDDD"},
+        {"f2l", "...FFFFFF...BBBBBB...RRRRRR...LLLLLL.........DDDDDDDDD"},
+        {"oll", "...FFFFFF...BBBBBB...RRRRRR...LLLLLLUUUUUUUUUDDDDDDDDD"},
+    };
+    for (const auto& p : patterns) {
+        if (strcmp(name, p.name) == 0) return parseGoalPattern(p.pattern, goal);
+    }
+    return false;
+}
+
+MovePlan movePlans[NOTATION_MOVE_COUNT];
+
+void buildMovePlan(MovePlan& plan, const uint8_t index[64]) {
+    for (int i = 0; i < 64; i++) {
+        plan.index[i] = index[i];
+    }
+    for (int c = 0; c < 4; c++) {
+        for (int o = 0; o < 4; o++) {
+            for (int k = 0; k < 16; k++) {
+                int src = index[o * 16 + k];
+                plan.select[c][o][k] = (src / 16 == c) ? (src % 16) : 0x80;
+            }
+        }
+    }
+}
+
+// Composing permutations is permuting the identity: run the moves on a
+// state whose bytes are their own positions, and byte i ends up holding the
+// position that lands on i. The move kernel does this at its full rate.
+void composeMoves(MovePlan& plan, const int* moves, int count) {
+    CubeState index;
+    for (int i = 0; i < 64; i++) {
+        index.sticker[i] = i;
+    }
+    moveKernel.applyMoves(index, moves, count);
+    buildMovePlan(plan, index.sticker);
+}
+
+// Move kernels. Each ISA provides a batch permute (one plan over many states)
+// and a sequence apply (many moves on one state kept in registers).
+static void permuteScalar(CubeState* states, size_t count, const MovePlan& plan) {
+    for (size_t n = 0; n < count; n++) {
+        CubeState next;
+        for (int i = 0; i < 64; i++) {
+            next.sticker[i] = states[n].sticker[plan.index[i]];
+        }
+        states[n] = next;
+    }
+}
+
+static void applyMovesScalar(CubeState& state, const int* moves, int count) {
+    for (int m = 0; m < count; m++) {
+        permuteScalar(&state, 1, movePlans[moves[m]]);
+    }
+}
+
+__attribute__((target("ssse3")))
+static inline void shuffleSSSE3(__m128i v[4], const MovePlan& plan) {
+    __m128i out[4];
+    for (int o = 0; o < 4; o++) {
+        const __m128i* sel = (const __m128i*)plan.select;
+        out[o] = _mm_or_si128(
+            _mm_or_si128(_mm_shuffle_epi8(v[0], _mm_load_si128(sel + 0 * 4 + o)),
+                         _mm_shuffle_epi8(v[1], _mm_load_si128(sel + 1 * 4 + o))),
+            _mm_or_si128(_mm_shuffle_epi8(v[2], _mm_load_si128(sel + 2 * 4 + o)),
+                         _mm_shuffle_epi8(v[3], _mm_load_si128(sel + 3 * 4 + o))));
+    }
+    for (int o = 0; o < 4; o++) {
+        v[o] = out[o];
+    }
+}
+
+__attribute__((target("ssse3")))
+static void permuteSSSE3(CubeState* states, size_t count, const MovePlan& plan) {
+    for (size_t n = 0; n < count; n++) {
+        __m128i* p = (__m128i*)states[n].sticker;
+        __m128i v[4] = {_mm_load_si128(p), _mm_load_si128(p + 1), _mm_load_si128(p + 2), _mm_load_si128(p + 3)};
+        shuffleSSSE3(v, plan);
+        for (int o = 0; o < 4; o++) {
+            _mm_store_si128(p + o, v[o]);
+        }
+    }
+}
+
+__attribute__((target("ssse3")))
+static void applyMovesSSSE3(CubeState& state, const int* moves, int count) {
+    __m128i* p = (__m128i*)state.sticker;
+    __m128i v[4] = {_mm_load_si128(p), _mm_load_si128(p + 1), _mm_load_si128(p + 2), _mm_load_si128(p + 3)};
+    for (int m = 0; m < count; m++) {
+        shuffleSSSE3(v, movePlans[moves[m]]);
+    }
+    for (int o = 0; o < 4; o++) {
+        _mm_store_si128(p + o, v[o]);
+    }
+}
+
+// vpshufb only shuffles within 128-bit lanes, so each input chunk is
+// broadcast to both lanes and the two output halves gather from all four
+__attribute__((target("avx2")))
+static inline void shuffleAVX2(__m256i& lo, __m256i& hi, const MovePlan& plan) {
+    __m256i c0 = _mm256_permute2x128_si256(lo, lo, 0x00);
+    __m256i c1 = _mm256_permute2x128_si256(lo, lo, 0x11);
+    __m256i c2 = _mm256_permute2x128_si256(hi, hi, 0x00);
+    __m256i c3 = _mm256_permute2x128_si256(hi, hi, 0x11);
+    const uint8_t* sel = &plan.select[0][0][0];
+    lo = _mm256_or_si256(
+        _mm256_or_si256(_mm256_shuffle_epi8(c0, _mm256_load_si256((const __m256i*)(sel + 0 * 64))),
+                        _mm256_shuffle_epi8(c1, _mm256_load_si256((const __m256i*)(sel + 1 * 64)))),
+        _mm256_or_si256(_mm256_shuffle_epi8(c2, _mm256_load_si256((const __m256i*)(sel + 2 * 64))),
+                        _mm256_shuffle_epi8(c3, _mm256_load_si256((const __m256i*)(sel + 3 * 64)))));
+    hi = _mm256_or_si256(
+        _mm256_or_si256(_mm256_shuffle_epi8(c0, _mm256_load_si256((const __m256i*)(sel + 0 * 64 + 32))),
+                        _mm256_shuffle_epi8(c1, _mm256_load_si256((const __m256i*)(sel + 1 * 64 + 32)))),
+        _mm256_or_si256(_mm256_shuffle_epi8(c2, _mm256_load_si256((const __m256i*)(sel + 2 * 64 + 32))),
+                        _mm256_shuffle_epi8(c3, _mm256_load_si256((const __m256i*)(sel + 3 * 64 + 32)))));
+}
+
+__attribute__((target("avx2")))
+static void permuteAVX2(CubeState* states, size_t count, const MovePlan& plan) {
+    for (size_t n = 0; n < count; n++) {
+        __m256i* p = (__m256i*)states[n].sticker;
+        __m256i lo = _mm256_load_si256(p);
+        __m256i hi = _mm256_load_si256(p + 1);
+        shuffleAVX2(lo, hi, plan);
+        _mm256_store_si256(p, lo);
+        _mm256_store_si256(p + 1, hi);
+    }
+}
+
+__attribute__((target("avx2")))
+static void applyMovesAVX2(CubeState& state, const int* moves, int count) {
+    __m256i* p = (__m256i*)state.sticker;
+    __m256i lo = _mm256_load_si256(p);
+    __m256i hi = _mm256_load_si256(p + 1);
+    for (int m = 0; m < count; m++) {
+        shuffleAVX2(lo, hi, movePlans[moves[m]]);
+    }
+    _mm256_store_si256(p, lo);
+    _mm256_store_si256(p + 1, hi);
+}
+
+// AVX-512 VBMI permutes all 64 bytes across lanes in a single vpermb (the
+// all-ones zero-mask form avoids GCC's uninitialized-passthrough warning)
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static void permuteAVX512(CubeState* states, size_t count, const MovePlan& plan) {
+    __m512i index = _mm512_load_si512(plan.index);
+    for (size_t n = 0; n < count; n++) {
+        __m512i v = _mm512_load_si512(states[n].sticker);
+        _mm512_store_si512(states[n].sticker, _mm512_maskz_permutexvar_epi8(~0ULL, index, v));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static void applyMovesAVX512(CubeState& state, const int* moves, int count) {
+    __m512i v = _mm512_load_si512(state.sticker);
+    for (int m = 0; m < count; m++) {
+        v = _mm512_maskz_permutexvar_epi8(~0ULL, _mm512_load_si512(movePlans[moves[m]].index), v);
+    }
+    _mm512_store_si512(state.sticker, v);
+}
+
+MoveKernel moveKernel = {"scalar", permuteScalar, applyMovesScalar};
+
+std::vector<MoveKernel> supportedMoveKernels() {
+    __builtin_cpu_init();
+    std::vector<MoveKernel> kernels = {{"scalar", permuteScalar, applyMovesScalar}};
+    if (__builtin_cpu_supports("ssse3")) kernels.push_back({"ssse3", permuteSSSE3, applyMovesSSSE3});
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", permuteAVX2, applyMovesAVX2});
+    if (__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw")) {
+        kernels.push_back({"avx512vbmi", permuteAVX512, applyMovesAVX512});
+    }
+    return kernels;
+}
+
+// Pick the widest kernel the CPU supports, and the goal test to match
+static void selectMoveKernel() {
+    moveKernel = supportedMoveKernels().back();
+    if (__builtin_cpu_supports("ssse3")) matchGoalKernel = matchesGoalSSSE3;
+}
+
+// Build the move plans by running performFaceRotation on a state whose
+// stickers are labelled with their own positions
+static void buildMoveTables() {
+    for (int face = 0; face < 6; face++) {
+        int labels[6][9];
+        for (int i = 0; i < 54; i++) {
+            labels[i / 9][i % 9] = i;
+        }
+        for (int turns = 1; turns <= 3; turns++) {
+            performFaceRotation(labels, face);
+            uint8_t index[64];
+            for (int i = 0; i < 64; i++) {
+                index[i] = i < 54 ? labels[i / 9][i % 9] : i;
+            }
+            buildMovePlan(movePlans[face * 3 + turns - 1], index);
+        }
+    }
+    selectMoveKernel();
+
+    // Slices from the NxN layer turns, which agree with the face turns above;
+    // wide turns and rotations are composed from face and slice turns
+    for (int face = 0; face < 6; face++) {
+        const auto& slice = layerTurnTable<3>.turns[6 + face];
+        for (int turns = 1; turns <= 3; turns++) {
+            uint8_t index[64];
+            for (int i = 0; i < 64; i++) {
+                index[i] = i;
+            }
+            applyLayerCycles(index, slice.cycles, slice.count, turns);
+            buildMovePlan(movePlans[18 + face * 3 + turns - 1], index);
+        }
+    }
+    for (int face = 0; face < 6; face++) {
+        for (int turns = 1; turns <= 3; turns++) {
+            int move = face * 3 + turns - 1;
+            int wide[2] = {move, 18 + move};
+            composeMoves(movePlans[36 + move], wide, 2);
+            // The opposite face turns back the other way
+            int rotation[3] = {move, 18 + move, (face ^ 1) * 3 + 3 - turns};
+            composeMoves(movePlans[54 + move], rotation, 3);
+        }
+    }
+}
+
+void initMoveTables() {
+    static std::once_flag initialized;
+    std::call_once(initialized, buildMoveTables);
+}
+
+CubeState solvedCubeState() {
+    CubeState state = {};
+    for (int i = 0; i < 54; i++) {
+        state.sticker[i] = i / 9;
+    }
+    return state;
+}
+
+CubeState toCubeState(const int state[6][9]) {
+    CubeState result = {};
+    for (int i = 0; i < 54; i++) {
+        result.sticker[i] = state[i / 9][i % 9];
+    }
+    return result;
+}
+
+void fromCubeState(const CubeState& state, int result[6][9]) {
+    for (int i = 0; i < 54; i++) {
+        result[i / 9][i % 9] = state.sticker[i];
+    }
+}
+
+void applyMove(CubeState& state, int move) {
+    moveKernel.permute(&state, 1, movePlans[move]);
+}
+
+void applyMoves(CubeState& state, const int* moves, int count) {
+    moveKernel.applyMoves(state, moves, count);
+}
+
+void applyPlan(CubeState& state, const MovePlan& plan) {
+    moveKernel.permute(&state, 1, plan);
+}
+
+void applyPlan(CubeState* states, size_t count, const MovePlan& plan) {
+    moveKernel.permute(states, count, plan);
+}
+
+void normalizeCenters(CubeState& state) {
+    uint8_t recolor[6];
+    for (int face = 0; face < 6; face++) {
+        recolor[state.sticker[face * 9 + 4]] = face;
+    }
+    for (int i = 0; i < 54; i++) {
+        state.sticker[i] = recolor[state.sticker[i]];
+    }
+}
+
+void applyMovesBatch(CubeState* states, size_t count, const int* moves, int moveCount) {
+    MovePlan plan;
+    composeMoves(plan, moves, moveCount);
+    moveKernel.permute(states, count, plan);
+}
+
+const char* moveNames[NOTATION_MOVE_COUNT] = {
+    "F", "F2", "F'", "B", "B2", "B'", "R", "R2", "R'",
+    "L", "L2", "L'", "U", "U2", "U'", "D", "D2", "D'",
+    "S", "S2", "S'", "S'", "S2", "S", "M'", "M2", "M",
+    "M", "M2", "M'", "E'", "E2", "E", "E", "E2", "E'",
+    "Fw", "Fw2", "Fw'", "Bw", "Bw2", "Bw'", "Rw", "Rw2", "Rw'",
+    "Lw", "Lw2", "Lw'", "Uw", "Uw2", "Uw'", "Dw", "Dw2", "Dw'",
+    "z", "z2", "z'", "z'", "z2", "z", "x", "x2", "x'",
+    "x'", "x2", "x", "y", "y2", "y'", "y'", "y2", "y"
+};
+
+const char faceLetters[] = "FBRLUD";
+
+static bool isMoveSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Base move number of each notation letter, counting in threes: faces 0-5,
+// slices 6-11 (S follows F, M follows L, E follows D), wide turns 12-17 and
+// rotations 18-23; -1 for other characters
+struct NotationLetters {
+    int8_t base[256];
+    constexpr NotationLetters() : base() {
+        for (int c = 0; c < 256; c++) base[c] = -1;
+        const char faces[] = "FBRLUD", wide[] = "fbrlud";
+        for (int f = 0; f < 6; f++) {
+            base[(int)faces[f]] = f;
+            base[(int)wide[f]] = 12 + f;
+        }
+        base['S'] = 6;
+        base['M'] = 9;
+        base['E'] = 11;
+        base['z'] = 18;
+        base['x'] = 20;
+        base['y'] = 22;
+    }
+};
+
+static constexpr NotationLetters notationLetters;
+
+int parseMove(const char*& p, const char* end) {
+    while (p < end && isMoveSpace(*p)) p++;
+    if (p == end) return -1;
+    int base = notationLetters.base[(uint8_t)*p];
+    if (base < 0) return -2;
+    const char* q = p + 1;
+    if (base < 6 && q < end && *q == 'w') {
+        base += 12;
+        q++;
+    }
+    int turns = 1;
+    if (q < end && *q >= '1' && *q <= '3') turns = *q++ - '0';
+    if (q < end && *q == '\'') {
+        turns = 4 - turns;
+        q++;
+    }
+    p = q;
+    return base * 3 + turns - 1;
+}
+
+// Expanded algorithms are capped, so nested repeats cannot exhaust memory
+const size_t ALGORITHM_MAX_MOVES = 1 << 20;
+
+// Optional repeat count and inverse after a group
+static bool parseGroupSuffix(const char*& p, const char* end, std::vector<int>& group) {
+    long repeat = 1;
+    if (p < end && *p >= '0' && *p <= '9') {
+        repeat = 0;
+        while (p < end && *p >= '0' && *p <= '9' && repeat <= (long)ALGORITHM_MAX_MOVES) repeat = repeat * 10 + *p++ - '0';
+    }
+    if (p < end && *p == '\'') {
+        std::reverse(group.begin(), group.end());
+        for (int& move : group) move = inverseMove(move);
+        p++;
+    }
+    if (group.size() * repeat > ALGORITHM_MAX_MOVES) return false;
+    size_t length = group.size();
+    group.resize(length * repeat);
+    for (long r = 1; r < repeat; r++) std::copy_n(group.begin(), length, group.begin() + r * length);
+    return true;
+}
+
+static void appendInverse(std::vector<int>& moves, const std::vector<int>& sequence) {
+    for (size_t i = sequence.size(); i-- > 0;) moves.push_back(inverseMove(sequence[i]));
+}
+
+// Moves up to the end of the text or one of the stop characters
+static bool parseSequence(const char*& p, const char* end, const char* stops, std::vector<int>& moves) {
+    for (;;) {
+        while (p < end && isMoveSpace(*p)) p++;
+        if (p == end || (*p && strchr(stops, *p))) return true;
+        if (*p == '(' || *p == '[') {
+            bool commutator = *p == '[';
+            p++;
+            std::vector<int> group, second;
+            if (!parseSequence(p, end, commutator ? ",:" : ")", group) || p == end) return false;
+            if (commutator) {
+                // [A, B] = A B A' B' and [A: B] = A B A'
+                bool conjugate = *p++ == ':';
+                if (!parseSequence(p, end, "]", second) || p == end) return false;
+                std::vector<int> a = std::move(group);
+                group = a;
+                group.insert(group.end(), second.begin(), second.end());
+                appendInverse(group, a);
+                if (!conjugate) appendInverse(group, second);
+            }
+            p++;
+            if (!parseGroupSuffix(p, end, group)) return false;
+            moves.insert(moves.end(), group.begin(), group.end());
+        } else {
+            int move = parseMove(p, end);
+            if (move < 0) return false;
+            moves.push_back(move);
+        }
+        if (moves.size() > ALGORITHM_MAX_MOVES) return false;
+    }
+}
+
+bool parseAlgorithm(const char*& p, const char* end, std::vector<int>& moves) {
+    moves.clear();
+    return parseSequence(p, end, "", moves);
+}
+
+bool compileAlgorithm(const char*& p, const char* end, MovePlan& plan) {
+    static thread_local std::vector<int> moves;
+    if (!parseAlgorithm(p, end, moves)) return false;
+    composeMoves(plan, moves.data(), moves.size());
+    return true;
+}
+
+int formatMoves(const int* moves, int count, char* out) {
+    char* p = out;
+    for (int i = 0; i < count; i++) {
+        if (i > 0) *p++ = ' ';
+        for (const char* name = moveNames[moves[i]]; *name; name++) *p++ = *name;
+    }
+    return p - out;
+}
+
+Cube::Cube() {
+    initMoveTables();
+    current = solvedCubeState();
+}
+
+Cube::Cube(const CubeState& state) : current(state), atSolved(isSolved(state)) {
+    initMoveTables();
+}
+
+void Cube::scramble(unsigned seed, int moves) {
+    ScrambleRng rng(seed);
+    scramble(rng, moves);
+}
+
+void Cube::scramble(ScrambleRng& rng, int moves) {
+    int buffer[64];
+    std::vector<int> large;
+    int* sequence = buffer;
+    if (moves > 64) {
+        large.resize(moves);
+        sequence = large.data();
+    }
+    randomScramble(rng, sequence, moves);
+    apply(sequence, moves);
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Cube model: sticker state, face turns and move tables. Nothing here touches
+// OpenGL, so the model can be used headless and from many threads at once.
+//
+// Faces are numbered in the order of the viewer's 1-6 keys:
+// 0=front, 1=back, 2=right, 3=left, 4=top, 5=bottom. A face's stickers are
+// stored row by row (0-8) as seen when looking at that face.
+
+// Reference face turns on a [face][position] sticker array. These define the
+// move semantics; the move tables below are generated from them.
+void rotateFaceClockwise(int state[6][9], int face);
+void rotateAdjacentEdges(int state[6][9], int face);
+void performFaceRotation(int state[6][9], int face);
+
+// Compact cube state: one byte per sticker, stored face-major (face * 9 + pos)
+// with the same face order and sticker layout as the [6][9] arrays. The state
+// is padded to 64 bytes so it fits one AVX-512 register (or two AVX2 / four
+// SSE registers); the padding bytes are always zero.
+struct alignas(64) CubeState {
+    uint8_t sticker[64];
+};
+
+// Equality and the goal tests below compare the whole 64-byte state at once
+// in SSE registers, with no branch per sticker
+bool operator==(const CubeState& a, const CubeState& b);
+bool operator!=(const CubeState& a, const CubeState& b);
+
+// Whether every face shows a single colour, so a cube turned whole by
+// rotations or slices still counts as solved. Cube::solved and the solved()
+// of CubeN and BigCube (cube_nxn.h) mean the same.
+bool isSolved(const CubeState& state);
+
+// Goal patterns for search goal tests and training targets: a state matches
+// when every sticker under the mask shows the pattern's colour, whatever
+// the rest show. Patterns are relative to the centres: a face letter stands
+// for the colour of that face's centre in the state being tested, so
+// matching is the same as matching the state after normalizeCenters.
+// "solved" matches exactly when isSolved does, and "cross" matches a cross
+// on whichever face is at the bottom, after any rotations or slices.
+struct GoalPattern {
+    alignas(64) uint8_t sticker[64];
+    alignas(64) uint8_t mask[64];       // 0xff where the sticker counts, else 0
+};
+
+bool matchesGoal(const CubeState& state, const GoalPattern& goal);
+
+// A pattern from 54 characters in CubeState order: a face letter (see
+// faceLetters) for a sticker that must show the colour of that face's
+// centre, '.' for one that may show anything. Returns false on any other
+// text.
+bool parseGoalPattern(const char* text, GoalPattern& goal);
+
+// Built-in patterns for solving from the bottom (D) face up: "solved",
+// "cross", "first-layer", "f2l" (first two layers) and "oll" (f2l and the
+// top face). Returns false for an unknown name.
+bool namedGoalPattern(const char* name, GoalPattern& goal);
+
+// Moves are numbered face * 3 + (quarterTurns - 1), so 0 = Front, 1 = Front x2,
+// 2 = Front counter-clockwise, 3 = Back, ... using the same face order as the 1-6 keys
+const int MOVE_COUNT = 18;
+
+// Notation moves extend the face turns, again three per base move, with the
+// base moves in face order within each group:
+//   18-35 slice turns, numbered as the layer behind each face the way
+//         cube_nxn.h numbers layer turns (S = 18, M = 27, E = 33)
+//   36-53 wide turns: a face and the slice behind it (Fw = 36, Rw = 42)
+//   54-71 whole-cube rotations following a face (z = 54, x = 60, y = 66)
+// Slices and rotations move the centres. The solvers only know moves 0-17;
+// see normalizeCenters.
+const int NOTATION_MOVE_COUNT = 72;
+
+// The inverse of any move
+inline int inverseMove(int move) { return move / 3 * 3 + 2 - move % 3; }
+
+// A 64-byte permutation prepared for every move kernel. index[i] is the byte
+// that lands on byte i (padding bytes map to themselves). select[c][o] is the
+// pshufb control that pulls the bytes of output chunk o out of input chunk c,
+// with 0x80 for bytes that come from another chunk.
+struct MovePlan {
+    alignas(64) uint8_t index[64];
+    alignas(64) uint8_t select[4][4][16];
+};
+
+extern MovePlan movePlans[NOTATION_MOVE_COUNT];
+
+void buildMovePlan(MovePlan& plan, const uint8_t index[64]);
+
+// Compose a move sequence into one permutation: applying the result once is
+// the same as applying every move in order
+void composeMoves(MovePlan& plan, const int* moves, int count);
+
+struct MoveKernel {
+    const char* name;
+    void (*permute)(CubeState* states, size_t count, const MovePlan& plan);
+    void (*applyMoves)(CubeState& state, const int* moves, int count);
+};
+
+// The widest kernel the CPU supports, chosen by initMoveTables
+extern MoveKernel moveKernel;
+
+// Every kernel the CPU supports, narrowest (scalar) first, so each can be
+// checked against the others
+std::vector<MoveKernel> supportedMoveKernels();
+
+// Build the move plans and pick a kernel. Runs once; safe to call from any
+// thread, and must have run before the free move functions below are used
+// (constructing a Cube does it).
+void initMoveTables();
+
+CubeState solvedCubeState();
+CubeState toCubeState(const int state[6][9]);
+void fromCubeState(const CubeState& state, int result[6][9]);
+
+void applyMove(CubeState& state, int move);
+void applyMoves(CubeState& state, const int* moves, int count);
+
+// Apply a composed plan (see composeMoves) to one state or a batch of states
+void applyPlan(CubeState& state, const MovePlan& plan);
+void applyPlan(CubeState* states, size_t count, const MovePlan& plan);
+
+// Apply one move sequence to a whole batch of states. The sequence is
+// composed into a single permutation first, so every state costs one shuffle
+// no matter how long the sequence is.
+void applyMovesBatch(CubeState* states, size_t count, const int* moves, int moveCount);
+
+// Recolour the stickers so every centre shows its own face's colour. After
+// slices or rotations this is the same cube as seen from its current
+// orientation, with the centres back where the face turns expect them.
+void normalizeCenters(CubeState& state);
+
+// Move notation: a face letter (F B R L U D, the 1-6 key order), a wide turn
+// (Fw or f, ...), a slice (M E S) or a rotation (x y z), followed by an
+// optional count 1-3 and an optional '; R2' is R2 and R3 is R'. Tokens may
+// be separated by whitespace or written together (RUR'U').
+extern const char* moveNames[NOTATION_MOVE_COUNT];
+extern const char faceLetters[];
+
+// Parse the next move token starting at *p. Returns the move, -1 at the end
+// of the text, or -2 on a malformed token; *p is left at the token.
+int parseMove(const char*& p, const char* end);
+
+// Parse a whole algorithm into moves, expanding groups: "(A)n" repeats A
+// n times and "(A)'" inverts it, "[A, B]" is the commutator A B A' B' and
+// "[A: B]" the conjugate A B A'. Returns false on malformed text, with *p
+// left at the error.
+bool parseAlgorithm(const char*& p, const char* end, std::vector<int>& moves);
+
+// Parse an algorithm and compose it into one permutation, so applying it
+// costs a single shuffle however long it is
+bool compileAlgorithm(const char*& p, const char* end, MovePlan& plan);
+
+// Write a move list in notation; returns the number of characters written
+// (at most 3 per face turn and 4 per other move, with the separating space)
+int formatMoves(const int* moves, int count, char* out);
+
+class ScrambleRng;
+
+// One simulated cube. Cubes are plain values with no shared mutable state,
+// so any number of them can be turned concurrently on different threads.
+class Cube {
+public:
+    Cube();
+    explicit Cube(const CubeState& state);
+
+    const CubeState& state() const { return current; }
+
+    // Solved-ness in any orientation (see isSolved), kept up to date by
+    // every turn, so asking is free
+    bool solved() const { return atSolved; }
+    int sticker(int face, int pos) const { return current.sticker[face * 9 + pos]; }
+
+    // Clockwise quarter turn of a face, the same as performFaceRotation
+    void turn(int face) { apply(face * 3); }
+    void apply(int move) {
+        applyMove(current, move);
+        atSolved = isSolved(current);
+    }
+    void apply(const int* moves, int count) {
+        applyMoves(current, moves, count);
+        atSolved = isSolved(current);
+    }
+
+    void reset() {
+        current = solvedCubeState();
+        atSolved = true;
+    }
+
+    // Apply random moves (see randomScramble); the same seed gives the same
+    // scramble
+    void scramble(unsigned seed, int moves = 20);
+    void scramble(ScrambleRng& rng, int moves = 20);
+
+private:
+    CubeState current;
+    bool atSolved = true;
+};
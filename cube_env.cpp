@@ -0,0 +1,70 @@
+#include "cube_env.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "scramble.h"
+#include "thread_pool.h"
+
+// Environments stepped or reset per pool task; a batch this small or
+// smaller runs on the calling thread alone
+const size_t ENVS_PER_TASK = 4096;
+
+CubeEnvBatch::CubeEnvBatch(size_t count, uint64_t seed, WorkStealingPool* pool)
+    : count(count), seed(seed), pool(pool ? pool : &WorkStealingPool::shared()) {
+    initMoveTables();
+    stateRows.assign(count, solvedCubeState());
+    solvedFlags.assign(count, 1);
+    episodes.assign(count, 0);
+}
+
+// Run body(first, last) over blocks of environments on the pool
+template <typename Body>
+void CubeEnvBatch::forEachBlock(Body body) {
+    if (count <= ENVS_PER_TASK) {
+        body(0, count);
+        return;
+    }
+    size_t tasks = (count + ENVS_PER_TASK - 1) / ENVS_PER_TASK;
+    pool->parallelFor(tasks, [&](size_t t) { body(t * ENVS_PER_TASK, std::min(count, (t + 1) * ENVS_PER_TASK)); });
+}
+
+void CubeEnvBatch::setGoal(const GoalPattern* newGoal) {
+    hasGoal = newGoal != nullptr;
+    if (newGoal) goal = *newGoal;
+    forEachBlock([&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) solvedFlags[i] = atGoal(stateRows[i]);
+    });
+}
+
+size_t CubeEnvBatch::step(const int* actions) {
+    std::atomic<size_t> solvedCount{0};
+    forEachBlock([&](size_t first, size_t last) {
+        size_t blockSolved = 0;
+        for (size_t i = first; i < last; i++) {
+            if ((unsigned)actions[i] < (unsigned)MOVE_COUNT) {
+                applyMove(stateRows[i], actions[i]);
+                solvedFlags[i] = atGoal(stateRows[i]);
+            }
+            blockSolved += solvedFlags[i];
+        }
+        solvedCount.fetch_add(blockSolved, std::memory_order_relaxed);
+    });
+    return solvedCount.load();
+}
+
+void CubeEnvBatch::reset(const uint8_t* mask, int scrambleMoves) {
+    scrambleMoves = std::max(scrambleMoves, 0);
+    const CubeState solvedState = solvedCubeState();
+    forEachBlock([&](size_t first, size_t last) {
+        std::vector<int> sequence(scrambleMoves);
+        for (size_t i = first; i < last; i++) {
+            if (mask && !mask[i]) continue;
+            ScrambleRng rng(seed ^ (i * 0xd1b54a32d192ed03ULL) ^ (episodes[i]++ * 0x9e3779b97f4a7c15ULL));
+            randomScramble(rng, sequence.data(), scrambleMoves);
+            stateRows[i] = solvedState;
+            applyMoves(stateRows[i], sequence.data(), scrambleMoves);
+            solvedFlags[i] = atGoal(stateRows[i]);
+        }
+    });
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cube.h"
+
+class WorkStealingPool;
+
+// A batch of independent cube environments for reinforcement learning:
+// count 3x3 states stepped together, one face turn each per step, across a
+// thread pool. The states live in one contiguous, 64-byte aligned buffer of
+// CubeState rows that the batch owns for its whole life, so a trainer can
+// read observations in place as a count x 64 byte array (stickers 0-53 in
+// CubeState order, then zero padding) with no copy per step. Rows rather
+// than sticker planes, because each environment takes its own move and a
+// row turns with a single shuffle of the move kernels.
+//
+// Resets draw random scrambles from a generator keyed by the seed, the
+// environment and its episode number, so a run is reproducible whatever the
+// thread count or the order of resets.
+class CubeEnvBatch {
+public:
+    // count environments, all solved; pool defaults to
+    // WorkStealingPool::shared()
+    explicit CubeEnvBatch(size_t count, uint64_t seed = 0, WorkStealingPool* pool = nullptr);
+
+    size_t size() const { return count; }
+
+    // The state buffer, size() rows, stable for the life of the batch
+    CubeState* states() { return stateRows.data(); }
+    const CubeState* states() const { return stateRows.data(); }
+
+    // One byte per environment, 1 where the state is solved (or matches the
+    // goal, see setGoal) as of the last step or reset; stable for the life
+    // of the batch
+    const uint8_t* solved() const { return solvedFlags.data(); }
+
+    // Count a state as solved when it matches goal instead, e.g. a cross or
+    // first two layers; the flags are refreshed. Null restores full solves.
+    void setGoal(const GoalPattern* goal);
+
+    // Apply actions[i] to environment i. Actions are face turns 0-17; any
+    // other value leaves that environment as it is. Returns the number of
+    // environments solved afterwards.
+    size_t step(const int* actions);
+
+    // Start a new episode in every environment whose mask byte is non-zero,
+    // or in all of them when mask is null: a random scramble of
+    // scrambleMoves face turns from solved (0 leaves it solved)
+    void reset(const uint8_t* mask = nullptr, int scrambleMoves = 25);
+
+    // Episodes started so far in environment i
+    uint64_t episode(size_t i) const { return episodes[i]; }
+
+private:
+    template <typename Body>
+    void forEachBlock(Body body);
+    bool atGoal(const CubeState& state) const { return hasGoal ? matchesGoal(state, goal) : isSolved(state); }
+
+    size_t count;
+    uint64_t seed;
+    WorkStealingPool* pool;
+    GoalPattern goal;
+    bool hasGoal = false;
+    std::vector<CubeState> stateRows;
+    std::vector<uint8_t> solvedFlags;
+    std::vector<uint64_t> episodes;
+};
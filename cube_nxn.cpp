@@ -0,0 +1,81 @@
+#include "cube_nxn.h"
+
+#include <array>
+#include <map>
+#include <mutex>
+
+void randomLayerScramble(ScrambleRng& rng, int n, int* moves, int count) {
+    int lastSlab = -1;
+    for (int i = 0; i < count; i++) {
+        int move, slab;
+        do {
+            move = rng.below(layerMoveCount(n));
+            int face = move / 3 % 6, layer = move / 18;
+            // Opposite faces turn the same slab at complementary depths
+            slab = FACE_AXIS[face] * n + (FACE_SIGN[face] > 0 ? n - 1 - layer : layer);
+        } while (slab == lastSlab);
+        moves[i] = move;
+        lastSlab = slab;
+    }
+}
+
+struct BigCube::Tables {
+    struct Turn {
+        int count = 0;
+        std::vector<std::array<uint32_t, 4>> cycles;
+    };
+    std::vector<Turn> turns;
+};
+
+// Tables are shared by every cube of a size while any such cube exists
+static std::shared_ptr<const BigCube::Tables> bigCubeTables(int n) {
+    static std::mutex mutex;
+    static std::map<int, std::weak_ptr<const BigCube::Tables>> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const BigCube::Tables> tables = cache[n].lock();
+    if (tables) return tables;
+    auto built = std::make_shared<BigCube::Tables>();
+    built->turns.resize(cubeLayerCount(n) * 6);
+    for (int layer = 0; layer < cubeLayerCount(n); layer++) {
+        for (int face = 0; face < 6; face++) {
+            BigCube::Tables::Turn& turn = built->turns[layer * 6 + face];
+            turn.cycles.resize(maxLayerTurnCycles(n));
+            buildLayerTurn(n, face, layer, turn);
+            turn.cycles.resize(turn.count);
+        }
+    }
+    cache[n] = built;
+    return built;
+}
+
+BigCube::BigCube(int size) : n(size < 2 ? 2 : size), tables(bigCubeTables(n)) {
+    reset();
+}
+
+void BigCube::apply(int move) {
+    const Tables::Turn& turn = tables->turns[move / 3];
+    applyLayerCycles(current.data(), (const uint32_t (*)[4])turn.cycles.data(), turn.count, move % 3 + 1);
+}
+
+void BigCube::apply(const int* moves, int count) {
+    for (int i = 0; i < count; i++) apply(moves[i]);
+}
+
+void BigCube::reset() {
+    current.resize(cubeStickerCount(n));
+    for (size_t i = 0; i < current.size(); i++) current[i] = i / ((size_t)n * n);
+}
+
+bool BigCube::solved() const {
+    size_t faceStickers = (size_t)n * n;
+    for (size_t i = 0; i < current.size(); i++) {
+        if (current[i] != current[i / faceStickers * faceStickers]) return false;
+    }
+    return true;
+}
+
+void BigCube::scramble(ScrambleRng& rng, int moves) {
+    std::vector<int> sequence(moves);
+    randomLayerScramble(rng, n, sequence.data(), moves);
+    apply(sequence.data(), moves);
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "cube.h"
+#include "scramble.h"
+
+// NxN cubes, from 2x2 up. The size is a template parameter of CubeN, so the
+// sticker array and the layer-turn tables are sized and built at compile
+// time; BigCube is the same model with the size chosen at run time, for
+// sizes too large to instantiate.
+//
+// Stickers use the layout of cube.h generalised to N: face-major, each face
+// row by row as seen looking at it, in the F B R L U D order. A 3x3 CubeN is
+// the CubeState of cube.h itself and turns with the SIMD move kernels, so
+// it also takes the notation moves of cube.h.
+//
+// A layer turn turns one slab of cubies, counted from a face inwards: layer 0
+// is the face, layer 1 the slab behind it, up to the middle. Layer turns are
+// numbered (layer * 6 + face) * 3 + (quarterTurns - 1), so moves 0-17 are
+// the face turns of cube.h and a 3x3 move is the same number on every size.
+
+constexpr int cubeStickerCount(int n) { return 6 * n * n; }
+constexpr int cubeLayerCount(int n) { return (n + 1) / 2; }
+constexpr int layerMoveCount(int n) { return cubeLayerCount(n) * 18; }
+
+constexpr int layerMove(int face, int layer, int quarterTurns) {
+    return (layer * 6 + face) * 3 + quarterTurns - 1;
+}
+
+// Axis (0=x, 1=y, 2=z) and direction of each face's outward normal
+constexpr int FACE_AXIS[6] = {2, 2, 0, 0, 1, 1};
+constexpr int FACE_SIGN[6] = {1, -1, 1, -1, 1, -1};
+
+constexpr int faceOfNormal(int axis, int sign) {
+    return axis == 2 ? (sign > 0 ? 0 : 1) : axis == 0 ? (sign > 0 ? 2 : 3) : (sign > 0 ? 4 : 5);
+}
+
+// Cubie centre of a sticker in doubled coordinates, so the centres of an NxN
+// cube are -(n-1), -(n-3), ..., n-1 on every axis for odd and even n alike
+constexpr void stickerPosition(int n, int index, int p[3]) {
+    int face = index / (n * n), pos = index % (n * n);
+    int edge = n - 1, r = 2 * (pos / n) - edge, c = 2 * (pos % n) - edge;
+    switch (face) {
+        case 0: p[0] = c;     p[1] = -r;    p[2] = edge;  break;
+        case 1: p[0] = -c;    p[1] = -r;    p[2] = -edge; break;
+        case 2: p[0] = edge;  p[1] = -r;    p[2] = -c;    break;
+        case 3: p[0] = -edge; p[1] = -r;    p[2] = c;     break;
+        case 4: p[0] = c;     p[1] = edge;  p[2] = r;     break;
+        case 5: p[0] = c;     p[1] = -edge; p[2] = -r;    break;
+    }
+}
+
+// Inverse of stickerPosition for a cubie on the given face
+constexpr int stickerIndexAt(int n, int face, const int p[3]) {
+    int r = 0, c = 0;
+    switch (face) {
+        case 0: r = -p[1]; c = p[0];  break;
+        case 1: r = -p[1]; c = -p[0]; break;
+        case 2: r = -p[1]; c = -p[2]; break;
+        case 3: r = -p[1]; c = p[2];  break;
+        case 4: r = p[2];  c = p[0];  break;
+        case 5: r = -p[2]; c = p[0];  break;
+    }
+    return face * n * n + (r + n - 1) / 2 * n + (c + n - 1) / 2;
+}
+
+// Where a clockwise quarter turn about the face's axis (seen from outside
+// that face) takes a sticker of the turning layer
+constexpr int layerTurnTarget(int n, int face, int index) {
+    int a = FACE_AXIS[face], u = (a + 1) % 3, w = (a + 2) % 3, s = FACE_SIGN[face];
+    int p[3] = {}, normal[3] = {};
+    stickerPosition(n, index, p);
+    int from = index / (n * n);
+    normal[FACE_AXIS[from]] = FACE_SIGN[from];
+    int pu = p[u], nu = normal[u];
+    p[u] = s * p[w];
+    p[w] = -s * pu;
+    normal[u] = s * normal[w];
+    normal[w] = -s * nu;
+    int to = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (normal[axis]) to = faceOfNormal(axis, normal[axis]);
+    }
+    return stickerIndexAt(n, to, p);
+}
+
+constexpr int maxLayerTurnCycles(int n) { return n + n * n / 4; }
+
+// A clockwise quarter turn of one layer as 4-cycles of sticker positions:
+// the sticker at cycles[i][0] moves to cycles[i][1], and so on round. Only
+// the layer's outside ring and, for a face layer, the face itself are
+// visited, so building every turn of an NxN cube costs O(n^2). Turn needs
+// an int count and a cycles[][4] array with room for maxLayerTurnCycles(n).
+template <typename Turn>
+constexpr void buildLayerTurn(int n, int face, int layer, Turn& turn) {
+    int a = FACE_AXIS[face], u = (a + 1) % 3, w = (a + 2) % 3, edge = n - 1;
+    bool outer = layer == 0;
+    turn.count = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j += outer || i == 0 || i == n - 1 ? 1 : n - 1) {
+            int p[3] = {};
+            p[a] = FACE_SIGN[face] * (edge - 2 * layer);
+            p[u] = 2 * i - edge;
+            p[w] = 2 * j - edge;
+            for (int g = 0; g < 6; g++) {
+                if (p[FACE_AXIS[g]] * FACE_SIGN[g] != edge) continue;
+                // Record each cycle once, from its smallest position
+                int cycle[4] = {stickerIndexAt(n, g, p), 0, 0, 0};
+                bool first = true;
+                for (int k = 1; k < 4; k++) {
+                    cycle[k] = layerTurnTarget(n, face, cycle[k - 1]);
+                    if (cycle[k] < cycle[0]) first = false;
+                }
+                if (cycle[1] == cycle[0] || !first) continue;
+                for (int k = 0; k < 4; k++) turn.cycles[turn.count][k] = cycle[k];
+                turn.count++;
+            }
+        }
+    }
+}
+
+// Apply QUARTER_TURNS clockwise quarter turns given as 4-cycles
+template <int QUARTER_TURNS, typename Index>
+inline void rotateLayerCycles(uint8_t* sticker, const Index (*cycles)[4], int count) {
+    for (int i = 0; i < count; i++) {
+        const Index* c = cycles[i];
+        uint8_t s[4] = {sticker[c[0]], sticker[c[1]], sticker[c[2]], sticker[c[3]]};
+        for (int k = 0; k < 4; k++) sticker[c[(k + QUARTER_TURNS) & 3]] = s[k];
+    }
+}
+
+// Apply 1-3 clockwise quarter turns given as 4-cycles
+template <typename Index>
+inline void applyLayerCycles(uint8_t* sticker, const Index (*cycles)[4], int count, int quarterTurns) {
+    switch (quarterTurns) {
+        case 1: rotateLayerCycles<1>(sticker, cycles, count); break;
+        case 2: rotateLayerCycles<2>(sticker, cycles, count); break;
+        case 3: rotateLayerCycles<3>(sticker, cycles, count); break;
+    }
+}
+
+// Random layer turns for an n-cube, never turning the same slab twice in a
+// row; moves 0-17 alone on a 3x3 are better served by randomScramble
+void randomLayerScramble(ScrambleRng& rng, int n, int* moves, int count);
+
+// Sticker storage of an NxN cube; a 3x3 is stored as a CubeState
+template <int N>
+struct StickerArray {
+    uint8_t sticker[cubeStickerCount(N)];
+};
+
+template <int N>
+using CubeStateN = std::conditional_t<N == 3, CubeState, StickerArray<N>>;
+
+template <int N>
+bool operator==(const StickerArray<N>& a, const StickerArray<N>& b) {
+    return memcmp(a.sticker, b.sticker, sizeof(a.sticker)) == 0;
+}
+
+template <int N>
+bool operator!=(const StickerArray<N>& a, const StickerArray<N>& b) {
+    return !(a == b);
+}
+
+// Every layer turn of an NxN cube, built at compile time. Sticker positions
+// fit 16 bits up to N = 104.
+template <int N>
+struct LayerTurnTable {
+    struct Turn {
+        int count = 0;
+        uint16_t cycles[maxLayerTurnCycles(N)][4] = {};
+    };
+    Turn turns[cubeLayerCount(N) * 6];
+
+    constexpr LayerTurnTable() {
+        for (int layer = 0; layer < cubeLayerCount(N); layer++) {
+            for (int face = 0; face < 6; face++) buildLayerTurn(N, face, layer, turns[layer * 6 + face]);
+        }
+    }
+};
+
+template <int N>
+inline constexpr LayerTurnTable<N> layerTurnTable{};
+
+// One NxN cube with the size fixed at compile time. Like Cube, a plain value
+// type that any number of threads can turn independently.
+template <int N>
+class CubeN {
+    static_assert(N >= 2 && N <= 104, "CubeN supports 2x2 to 104x104; use BigCube beyond");
+
+public:
+    static constexpr int SIZE = N;
+    static constexpr int STICKERS = cubeStickerCount(N);
+    static constexpr int MOVES = layerMoveCount(N);
+
+    CubeN() {
+        if constexpr (N == 3) initMoveTables();
+        reset();
+    }
+
+    const CubeStateN<N>& state() const { return current; }
+    int sticker(int face, int row, int col) const { return current.sticker[(face * N + row) * N + col]; }
+
+    void apply(int move) {
+        // A 3x3 turn is one shuffle on the move kernels, which also take the
+        // wide turns and rotations of cube.h
+        if constexpr (N == 3) {
+            applyMove(current, move);
+            return;
+        }
+        const auto& turn = layerTurnTable<N>.turns[move / 3];
+        applyLayerCycles(current.sticker, turn.cycles, turn.count, move % 3 + 1);
+    }
+
+    void apply(const int* moves, int count) {
+        for (int i = 0; i < count; i++) apply(moves[i]);
+    }
+
+    void turn(int face, int layer = 0, int quarterTurns = 1) { apply(layerMove(face, layer, quarterTurns)); }
+
+    void reset() {
+        memset(&current, 0, sizeof(current));
+        for (int i = 0; i < STICKERS; i++) current.sticker[i] = i / (N * N);
+    }
+
+    // Every face one colour, in any orientation, as isSolved
+    bool solved() const {
+        if constexpr (N == 3) return isSolved(current);
+        for (int i = 0; i < STICKERS; i++) {
+            if (current.sticker[i] != current.sticker[i / (N * N) * (N * N)]) return false;
+        }
+        return true;
+    }
+
+    void scramble(ScrambleRng& rng, int moves) {
+        std::vector<int> sequence(moves);
+        randomLayerScramble(rng, N, sequence.data(), moves);
+        apply(sequence.data(), moves);
+    }
+
+private:
+    CubeStateN<N> current;
+};
+
+// An NxN cube with the size chosen at run time, for any n >= 2. Its turn
+// tables are built on first use of a size and shared by all cubes of that
+// size; sticker positions are 32-bit, so there is no upper limit but memory.
+class BigCube {
+public:
+    explicit BigCube(int size = 3);
+
+    int size() const { return n; }
+    int moveCount() const { return layerMoveCount(n); }
+    const uint8_t* stickers() const { return current.data(); }
+    int sticker(int face, int row, int col) const { return current[((size_t)face * n + row) * n + col]; }
+
+    void apply(int move);
+    void apply(const int* moves, int count);
+    void turn(int face, int layer = 0, int quarterTurns = 1) { apply(layerMove(face, layer, quarterTurns)); }
+
+    void reset();
+    // Every face one colour, in any orientation, as CubeN::solved
+    bool solved() const;
+    void scramble(ScrambleRng& rng, int moves);
+
+    struct Tables;
+
+private:
+    int n;
+    std::shared_ptr<const Tables> tables;
+    std::vector<uint8_t> current;
+};
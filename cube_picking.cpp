@@ -0,0 +1,112 @@
+#include "cube_picking.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+// Vertical field of view of setProjection
+static const float FIELD_OF_VIEW_DEGREES = 45.0f;
+
+// Rotate v by degrees about a coordinate axis, right-handed as glRotatef
+static void rotate(float v[3], int axis, float degrees) {
+    int u = (axis + 1) % 3, w = (axis + 2) % 3;
+    float c = cosf(degrees * (float)M_PI / 180.0f), s = sinf(degrees * (float)M_PI / 180.0f);
+    float vu = v[u], vw = v[w];
+    v[u] = c * vu - s * vw;
+    v[w] = s * vu + c * vw;
+}
+
+PickRay cameraRay(float angleX, float angleY, float distance, int width, int height, float x, float y) {
+    if (height == 0) height = 1;
+    float scale = tanf(FIELD_OF_VIEW_DEGREES * 0.5f * (float)M_PI / 180.0f);
+    float ndcX = 2.0f * x / width - 1.0f, ndcY = 1.0f - 2.0f * y / height;
+
+    // Eye space, then undo applyCamera: translate, rotate about x, about y
+    PickRay ray = {{0.0f, 0.0f, distance}, {ndcX * scale * width / height, ndcY * scale, -1.0f}};
+    rotate(ray.origin, 0, -angleX);
+    rotate(ray.direction, 0, -angleX);
+    rotate(ray.origin, 1, -angleY);
+    rotate(ray.direction, 1, -angleY);
+    return ray;
+}
+
+// Slab test of the ray against an axis-aligned box: the entry distance and
+// the axis it enters through, or false if it misses or starts inside
+static bool enterBox(const PickRay& ray, const float center[3], float half, float& t, int& axis) {
+    float tNear = -INFINITY, tFar = INFINITY;
+    for (int a = 0; a < 3; a++) {
+        float lo = center[a] - half - ray.origin[a], hi = center[a] + half - ray.origin[a];
+        if (ray.direction[a] == 0.0f) {
+            if (lo > 0.0f || hi < 0.0f) return false;
+            continue;
+        }
+        float t0 = lo / ray.direction[a], t1 = hi / ray.direction[a];
+        if (t0 > t1) std::swap(t0, t1);
+        if (t0 > tNear) {
+            tNear = t0;
+            axis = a;
+        }
+        if (t1 < tFar) tFar = t1;
+    }
+    t = tNear;
+    return tNear <= tFar && tNear > 0.0f;
+}
+
+bool pickSticker(int n, const PickRay& ray, StickerPick& pick) {
+    const int edge = n - 1;
+    const float unit = 1.5f / n;                // half a doubled coordinate step
+    const float origin[3] = {0.0f, 0.0f, 0.0f};
+    float t;
+    int axis = 0;
+    if (!enterBox(ray, origin, 1.5f, t, axis)) return false;
+
+    // The nearest surface cubie; the inside of the cube is never seen
+    float nearest = INFINITY;
+    for (int x = -edge; x <= edge; x += 2) {
+        for (int y = -edge; y <= edge; y += 2) {
+            for (int z = -edge; z <= edge; z += 2) {
+                if (abs(x) != edge && abs(y) != edge && abs(z) != edge) continue;
+                const float center[3] = {x * unit, y * unit, z * unit};
+                int entered = 0;
+                if (!enterBox(ray, center, unit, t, entered) || t >= nearest) continue;
+                nearest = t;
+                axis = entered;
+                pick.cubie[0] = x;
+                pick.cubie[1] = y;
+                pick.cubie[2] = z;
+            }
+        }
+    }
+    if (nearest == INFINITY) return false;
+    int face = faceOfNormal(axis, ray.direction[axis] < 0.0f ? 1 : -1);
+    if (pick.cubie[axis] * FACE_SIGN[face] != edge) return false;
+    pick.face = face;
+    pick.sticker = stickerIndexAt(n, face, pick.cubie);
+    for (int a = 0; a < 3; a++) pick.point[a] = ray.origin[a] + nearest * ray.direction[a];
+    return true;
+}
+
+int dragTurn(int n, const StickerPick& pick, const PickRay& ray) {
+    // Where the cursor is now, on the plane of the picked face
+    int a = FACE_AXIS[pick.face];
+    if (ray.direction[a] == 0.0f) return -1;
+    float t = (pick.point[a] - ray.origin[a]) / ray.direction[a];
+    if (t <= 0.0f) return -1;
+    float drag[3];
+    for (int k = 0; k < 3; k++) drag[k] = ray.origin[k] + t * ray.direction[k] - pick.point[k];
+
+    // Dragging along b turns the layer about the third axis c through the
+    // picked cubie
+    int b = fabsf(drag[(a + 1) % 3]) >= fabsf(drag[(a + 2) % 3]) ? (a + 1) % 3 : (a + 2) % 3;
+    int c = 3 - a - b;
+    if (fabsf(drag[b]) < 1e-4f) return -1;
+    int edge = n - 1, position = pick.cubie[c];
+    int face = faceOfNormal(c, position >= 0 ? 1 : -1);
+    int layer = (edge - abs(position)) / 2;
+
+    // A clockwise turn carries the sticker over onto the side it moves
+    // toward; turn the other way if that is not the way of the drag
+    int to = layerTurnTarget(n, face, pick.sticker) / (n * n);
+    bool clockwise = FACE_AXIS[to] == b && FACE_SIGN[to] == (drag[b] > 0.0f ? 1 : -1);
+    return layerMove(face, layer, clockwise ? 1 : 3);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "cube_nxn.h"
+
+// Mouse picking without the GPU: the cursor's ray is rebuilt on the CPU from
+// the viewer's camera and cast against the cubie boxes, so an input event
+// costs a fraction of a microsecond on a 3x3 and never waits on GL
+// selection or a framebuffer readback. Model space is the renderer's: any
+// size is drawn as large as a 3x3, cubies one unit wide on a 3x3, centred
+// on the origin.
+
+struct PickRay {
+    float origin[3];
+    float direction[3];
+};
+
+// The ray through window position (x, y), y down as GLUT reports it, under
+// the orbit camera of applyCamera and the projection of setProjection
+// (cube_scene.h) for a width x height window
+PickRay cameraRay(float angleX, float angleY, float distance, int width, int height, float x, float y);
+
+struct StickerPick {
+    int sticker;        // index in the layout of cube_nxn.h
+    int face;
+    int cubie[3];       // cubie centre in doubled coordinates
+    float point[3];     // where the ray meets the sticker, in model space
+};
+
+// The sticker of an n-cube at rest that the ray hits first; false if the
+// ray misses the cube
+bool pickSticker(int n, const PickRay& ray, StickerPick& pick);
+
+// The quarter layer turn (numbered as in cube_nxn.h) that moves the picked
+// sticker the way the cursor was dragged, from the pick to where ray meets
+// the plane of the picked face. The drag's larger component along the face
+// picks the turn. -1 if the ray misses that plane or has hardly moved.
+int dragTurn(int n, const StickerPick& pick, const PickRay& ray);
@@ -0,0 +1,436 @@
+#define GL_GLEXT_PROTOTYPES
+#include "cube_renderer.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "frame_profiler.h"
+
+namespace {
+
+// Interleaved position and normal
+struct Vertex {
+    float position[3];
+    float normal[3];
+};
+
+void addQuad(std::vector<Vertex>& vertices, const float corners[4][3], const float normal[3],
+             const float center[3]) {
+    for (int k = 0; k < 4; k++) {
+        Vertex v = {{corners[k][0] + center[0], corners[k][1] + center[1], corners[k][2] + center[2]},
+                    {normal[0], normal[1], normal[2]}};
+        vertices.push_back(v);
+    }
+}
+
+// A square of the given half-size on the side of a cubie facing along axis,
+// wound counter-clockwise seen from outside
+void addSide(std::vector<Vertex>& vertices, const float center[3], int axis, int sign, float half, float offset) {
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    float normal[3] = {0, 0, 0};
+    normal[axis] = sign;
+    float corners[4][3];
+    const float square[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+    for (int k = 0; k < 4; k++) {
+        int c = sign > 0 ? k : 3 - k;
+        corners[k][axis] = offset * sign;
+        corners[k][u] = square[c][0] * half;
+        corners[k][v] = square[c][1] * half;
+    }
+    addQuad(vertices, corners, normal, center);
+}
+
+// Cubie and sticker geometry of an n-cube. Only cubies on the surface are
+// built: bodies are unlit black, so the hollow inside looks solid even while
+// a layer turns. Vertices are all bodies (24 each) then all stickers, in
+// cubie order, and each sticker quad records the sticker index it shows.
+struct CubeGeometry {
+    std::vector<Vertex> vertices;
+    std::vector<std::array<int, 3>> cubies;     // doubled coordinates, as in cube_nxn.h
+    std::vector<int> stickerQuad;               // first sticker quad of each cubie, plus the end
+    std::vector<int> stickerOfQuad;
+    int stickerVertexStart = 0;
+
+    explicit CubeGeometry(int n) {
+        int edge = n - 1;
+        for (int x = -edge; x <= edge; x += 2) {
+            for (int y = -edge; y <= edge; y += 2) {
+                for (int z = -edge; z <= edge; z += 2) {
+                    if (abs(x) == edge || abs(y) == edge || abs(z) == edge) cubies.push_back({x, y, z});
+                }
+            }
+        }
+        for (const auto& p : cubies) {
+            const float center[3] = {p[0] * 0.5f, p[1] * 0.5f, p[2] * 0.5f};
+            for (int axis = 0; axis < 3; axis++) {
+                for (int sign = -1; sign <= 1; sign += 2) addSide(vertices, center, axis, sign, 0.5f, 0.5f);
+            }
+        }
+        stickerVertexStart = vertices.size();
+        for (const auto& p : cubies) {
+            stickerQuad.push_back(stickerOfQuad.size());
+            const float center[3] = {p[0] * 0.5f, p[1] * 0.5f, p[2] * 0.5f};
+            for (int face = 0; face < 6; face++) {
+                if (p[FACE_AXIS[face]] * FACE_SIGN[face] != edge) continue;
+                // Inset sticker, just off the body
+                addSide(vertices, center, FACE_AXIS[face], FACE_SIGN[face], 0.45f, 0.501f);
+                stickerOfQuad.push_back(stickerIndexAt(n, face, p.data()));
+            }
+        }
+        stickerQuad.push_back(stickerOfQuad.size());
+    }
+};
+
+// Two triangles for the quad whose corners start at firstVertex
+void addQuadIndices(std::vector<unsigned>& indices, int firstVertex) {
+    const int corners[6] = {0, 1, 2, 0, 2, 3};
+    for (int k = 0; k < 6; k++) indices.push_back(firstVertex + corners[k]);
+}
+
+}  // namespace
+
+void CubeRenderer::init(const float colors[6][3], int cubeSize) {
+    memcpy(palette, colors, sizeof(palette));
+    size = std::max(cubeSize, 2);
+    CubeGeometry geometry(size);
+    stickerOfQuad = geometry.stickerOfQuad;
+    stickerVertexStart = geometry.stickerVertexStart;
+
+    // Indices: for every axis, the bodies slab by slab along it, then the
+    // stickers the same way, so any turning layer is one contiguous range
+    // with the rest of the cube on either side
+    std::vector<unsigned> indices;
+    for (int axis = 0; axis < 3; axis++) {
+        for (int part = 0; part < 2; part++) {
+            std::vector<int>& slabs = part == 0 ? bodySlabs[axis] : stickerSlabs[axis];
+            slabs.clear();
+            for (int slab = 0; slab < size; slab++) {
+                slabs.push_back(indices.size());
+                for (size_t c = 0; c < geometry.cubies.size(); c++) {
+                    if (geometry.cubies[c][axis] != 2 * slab - (size - 1)) continue;
+                    if (part == 0) {
+                        for (int q = 0; q < 6; q++) addQuadIndices(indices, (c * 6 + q) * 4);
+                    } else {
+                        for (int q = geometry.stickerQuad[c]; q < geometry.stickerQuad[c + 1]; q++) {
+                            addQuadIndices(indices, stickerVertexStart + q * 4);
+                        }
+                    }
+                }
+            }
+            slabs.push_back(indices.size());
+        }
+    }
+
+    // Colours: bodies stay black; sticker colours are filled in by update()
+    const std::vector<Vertex>& vertices = geometry.vertices;
+    std::vector<float> colorData(vertices.size() * 3, 0.0f);
+    stickerColors.assign((vertices.size() - stickerVertexStart) * 3, 0.0f);
+
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    glGenBuffers(1, &colorBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
+    glBufferData(GL_ARRAY_BUFFER, colorData.size() * sizeof(float), colorData.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    // 16-bit indices while they fit, which covers cubes up to 20x20
+    if (vertices.size() <= 65536) {
+        std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+        indexType = GL_UNSIGNED_SHORT;
+        indexSize = sizeof(unsigned short);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * indexSize, shortIndices.data(), GL_STATIC_DRAW);
+    } else {
+        indexType = GL_UNSIGNED_INT;
+        indexSize = sizeof(unsigned);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * indexSize, indices.data(), GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    uploaded.clear();
+}
+
+void CubeRenderer::update(const uint8_t* stickers) {
+    size_t count = cubeStickerCount(size);
+    if (uploaded.size() == count && memcmp(uploaded.data(), stickers, count) == 0) return;
+    float* out = stickerColors.data();
+    for (int sticker : stickerOfQuad) {
+        const float* color = palette[stickers[sticker]];
+        for (int k = 0; k < 4; k++) {
+            memcpy(out, color, 3 * sizeof(float));
+            out += 3;
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, stickerVertexStart * 3 * sizeof(float),
+                    stickerColors.size() * sizeof(float), stickerColors.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    uploaded.assign(stickers, stickers + count);
+}
+
+void CubeRenderer::drawRange(int start, int end) const {
+    if (end == start) return;
+    profileCount(PROFILE_DRAW_CALLS, 1);
+    profileCount(PROFILE_VERTICES, end - start);
+    glDrawElements(GL_TRIANGLES, end - start, indexType, (const void*)(start * indexSize));
+}
+
+void CubeRenderer::draw(int rotatingFace, float angle, int layer) const {
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), (const void*)offsetof(Vertex, position));
+    glNormalPointer(GL_FLOAT, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+    glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glColorPointer(3, GL_FLOAT, 0, nullptr);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+    // Every size is drawn as large as a 3x3
+    if (size != 3) {
+        glPushMatrix();
+        glScalef(3.0f / size, 3.0f / size, 3.0f / size);
+    }
+
+    bool rotating = rotatingFace >= 0 && rotatingFace < 6 && layer >= 0 && layer < cubeLayerCount(size);
+    int axis = rotating ? FACE_AXIS[rotatingFace] : 0;
+    int slab = !rotating ? size : FACE_SIGN[rotatingFace] > 0 ? size - 1 - layer : layer;
+    const std::vector<int>& bodies = bodySlabs[axis];
+    const std::vector<int>& stickers = stickerSlabs[axis];
+
+    // Bodies are unlit black, stickers lit by their colour. Without a turn
+    // the whole cube is the first range.
+    glDisable(GL_LIGHTING);
+    drawRange(bodies[0], bodies[slab]);
+    if (rotating) drawRange(bodies[slab + 1], bodies[size]);
+    glEnable(GL_LIGHTING);
+    drawRange(stickers[0], stickers[slab]);
+    if (rotating) drawRange(stickers[slab + 1], stickers[size]);
+
+    if (rotating) {
+        glPushMatrix();
+        float direction[3] = {0, 0, 0};
+        direction[axis] = FACE_SIGN[rotatingFace];
+        glRotatef(angle, direction[0], direction[1], direction[2]);
+        glDisable(GL_LIGHTING);
+        drawRange(bodies[slab], bodies[slab + 1]);
+        glEnable(GL_LIGHTING);
+        drawRange(stickers[slab], stickers[slab + 1]);
+        glPopMatrix();
+    }
+
+    if (size != 3) glPopMatrix();
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+namespace {
+
+const char* instancedVertexShader = R"(#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in float sticker;    // CubeState index, -1 on bodies
+layout(location = 3) in mat4 model;       // per instance, locations 3-6
+uniform mat4 view;
+uniform mat4 projection;
+uniform usampler2D states;                // row i holds the stickers of cube i
+uniform vec3 palette[6];
+out vec3 eyePosition;
+out vec3 eyeNormal;
+flat out vec3 color;
+void main() {
+    mat4 modelView = view * model;
+    vec4 eye = modelView * vec4(position, 1.0);
+    eyePosition = eye.xyz;
+    eyeNormal = mat3(modelView) * normal;
+    color = sticker < 0.0 ? vec3(0.0)
+          : palette[texelFetch(states, ivec2(int(sticker), gl_InstanceID), 0).r];
+    gl_Position = projection * eye;
+}
+)";
+
+// Per-pixel version of the viewer's fixed-function lighting: global ambient
+// 0.2, light 0 ambient 0.3 / diffuse 0.8 / specular 1.0, light 1 diffuse 0.4,
+// material specular 0.3 with shininess 20 and an infinite viewer
+const char* instancedFragmentShader = R"(#version 330 core
+in vec3 eyePosition;
+in vec3 eyeNormal;
+flat in vec3 color;
+uniform bool lit;
+uniform vec3 lightPosition[2];
+out vec4 fragColor;
+void main() {
+    if (!lit) {
+        fragColor = vec4(color, 1.0);
+        return;
+    }
+    vec3 n = normalize(eyeNormal);
+    vec3 l0 = normalize(lightPosition[0] - eyePosition);
+    vec3 l1 = normalize(lightPosition[1] - eyePosition);
+    float d0 = max(dot(n, l0), 0.0);
+    float d1 = max(dot(n, l1), 0.0);
+    float specular = d0 > 0.0 ? pow(max(dot(n, normalize(l0 + vec3(0.0, 0.0, 1.0))), 0.0), 20.0) : 0.0;
+    vec3 rgb = color * (0.2 + 0.3 + 0.8 * d0 + 0.4 * d1) + vec3(0.3 * specular);
+    fragColor = vec4(min(rgb, vec3(1.0)), 1.0);
+}
+)";
+
+unsigned compileShader(GLenum type, const char* source) {
+    unsigned shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        fprintf(stderr, "Shader compile failed: %s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+}  // namespace
+
+bool InstancedCubeRenderer::init(const float palette[6][3], int requested) {
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (!version || atof(version) < 3.3) return false;
+    unsigned vs = compileShader(GL_VERTEX_SHADER, instancedVertexShader);
+    unsigned fs = compileShader(GL_FRAGMENT_SHADER, instancedFragmentShader);
+    if (!vs || !fs) return false;
+    program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        glDeleteProgram(program);
+        program = 0;
+        return false;
+    }
+    viewLocation = glGetUniformLocation(program, "view");
+    projectionLocation = glGetUniformLocation(program, "projection");
+    litLocation = glGetUniformLocation(program, "lit");
+    lightLocation = glGetUniformLocation(program, "lightPosition");
+    glUseProgram(program);
+    glUniform3fv(glGetUniformLocation(program, "palette"), 6, &palette[0][0]);
+    glUniform1i(glGetUniformLocation(program, "states"), 0);
+    glUseProgram(0);
+
+    // Same cubie geometry as CubeRenderer, with each vertex tagged by the
+    // sticker it shows
+    CubeGeometry geometry(3);
+    const std::vector<Vertex>& vertices = geometry.vertices;
+    int stickerVertexStart = geometry.stickerVertexStart;
+    std::vector<float> sticker(vertices.size(), -1.0f);
+    for (size_t q = 0; q < geometry.stickerOfQuad.size(); q++) {
+        for (int k = 0; k < 4; k++) sticker[stickerVertexStart + q * 4 + k] = geometry.stickerOfQuad[q];
+    }
+    std::vector<unsigned> quadIndices;
+    for (size_t v = 0; v < vertices.size(); v += 4) addQuadIndices(quadIndices, v);
+    std::vector<unsigned short> indices(quadIndices.begin(), quadIndices.end());
+    bodyIndices = stickerVertexStart / 4 * 6;
+    stickerIndices = indices.size() - bodyIndices;
+
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex) + sticker.size() * sizeof(float),
+                 nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+    glBufferSubData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), sticker.size() * sizeof(float), sticker.data());
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 0, (const void*)(vertices.size() * sizeof(Vertex)));
+
+    GLint maxTexture = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexture);
+    maxInstances = std::max(0, std::min(requested, (int)maxTexture));
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)maxInstances * 16 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    for (int column = 0; column < 4; column++) {
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float),
+                              (const void*)(column * 4 * sizeof(float)));
+        glVertexAttribDivisor(3 + column, 1);
+    }
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenTextures(1, &stateTexture);
+    glBindTexture(GL_TEXTURE_2D, stateTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, 64, std::max(maxInstances, 1), 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    instances = 0;
+    return true;
+}
+
+void InstancedCubeRenderer::update(const CubeState* states, const float (*transforms)[16], int count) {
+    instances = std::max(0, std::min(count, maxInstances));
+    if (instances == 0) return;
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (size_t)instances * 16 * sizeof(float), transforms);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, stateTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 64, instances, GL_RED_INTEGER, GL_UNSIGNED_BYTE, states);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void InstancedCubeRenderer::draw() const {
+    if (!program || instances == 0) return;
+    float view[16], projection[16], light[2][4];
+    glGetFloatv(GL_MODELVIEW_MATRIX, view);
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    glGetLightfv(GL_LIGHT0, GL_POSITION, light[0]);
+    glGetLightfv(GL_LIGHT1, GL_POSITION, light[1]);
+    float lightPosition[2][3];
+    for (int i = 0; i < 2; i++) {
+        for (int k = 0; k < 3; k++) lightPosition[i][k] = light[i][k] / light[i][3];
+    }
+
+    glUseProgram(program);
+    glUniformMatrix4fv(viewLocation, 1, GL_FALSE, view);
+    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projection);
+    glUniform3fv(lightLocation, 2, &lightPosition[0][0]);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, stateTexture);
+    glBindVertexArray(vertexArray);
+
+    // One call per material: unlit black bodies, then lit stickers
+    profileCount(PROFILE_DRAW_CALLS, 2);
+    profileCount(PROFILE_VERTICES, (uint64_t)(bodyIndices + stickerIndices) * instances);
+    glUniform1i(litLocation, 0);
+    glDrawElementsInstanced(GL_TRIANGLES, bodyIndices, GL_UNSIGNED_SHORT, nullptr, instances);
+    glUniform1i(litLocation, 1);
+    glDrawElementsInstanced(GL_TRIANGLES, stickerIndices, GL_UNSIGNED_SHORT,
+                            (const void*)(bodyIndices * sizeof(unsigned short)), instances);
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
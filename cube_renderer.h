@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+
+#include "cube.h"
+#include "cube_nxn.h"
+
+// Retained-mode cube renderer for cubes of any size (3x3 by default). The
+// geometry of the surface cubies is built once into vertex and index
+// buffers; only the sticker colours are re-uploaded, and only when the cube
+// state changes. A frame is two draw calls, or up to six while a layer is
+// turning. Needs a current GL context with buffer objects (GL 1.5) and the
+// fixed-function lighting set up by the caller.
+class CubeRenderer {
+public:
+    // Build the buffers for an n-cube (see cube_nxn.h), drawn at the size of
+    // a 3x3; palette holds the RGB colour of each face's stickers
+    void init(const float palette[6][3], int size = 3);
+
+    int cubeSize() const { return size; }
+
+    // Upload the sticker colours if the state differs from the last upload.
+    // The state must be of the size given to init.
+    void update(const uint8_t* stickers);
+    void update(const CubeState& state) { update(state.sticker); }
+    template <int N>
+    void update(const StickerArray<N>& state) { update(state.sticker); }
+    void update(const BigCube& cube) { update(cube.stickers()); }
+
+    // Draw the cube, with the layer of rotatingFace (-1 for none) at the
+    // given depth turned by angle degrees
+    void draw(int rotatingFace, float angle, int layer = 0) const;
+
+private:
+    void drawRange(int start, int end) const;
+
+    int size = 3;
+    unsigned vertexBuffer = 0, colorBuffer = 0, indexBuffer = 0;
+    unsigned indexType = 0;
+    size_t indexSize = 0;
+    int stickerVertexStart = 0;
+    // Index offsets of each slab along each axis, plus the end: the bodies
+    // (and stickers) are ordered slab by slab once per axis
+    std::vector<int> bodySlabs[3], stickerSlabs[3];
+    float palette[6][3];
+    std::vector<uint8_t> uploaded;       // stickers as of the last upload
+    std::vector<float> stickerColors;    // staging for sticker colour uploads
+    std::vector<int> stickerOfQuad;      // sticker index of each sticker quad
+};
+
+// Instanced renderer for many cubes at once (a wall of live states). Every
+// cube has its own state and model matrix; all cubes are drawn with one
+// instanced call for the bodies and one for the stickers. States are uploaded
+// unchanged, one 64-byte CubeState per row of an integer texture, and the
+// shaders look sticker colours up in a palette. Needs GL 3.3, which Mesa's
+// llvmpipe provides, so it also runs on hosts without a GPU.
+class InstancedCubeRenderer {
+public:
+    // Compile the shaders and allocate room for up to maxInstances cubes
+    // (clamped to GL_MAX_TEXTURE_SIZE). Returns false if GL 3.3 shaders are
+    // not available.
+    bool init(const float palette[6][3], int maxInstances);
+
+    int capacity() const { return maxInstances; }
+
+    // Upload the states and column-major model matrices of the first count
+    // cubes; count beyond capacity() is clipped
+    void update(const CubeState* states, const float (*transforms)[16], int count);
+
+    // Draw the uploaded cubes. The camera and the eye-space positions of
+    // GL_LIGHT0 and GL_LIGHT1 are taken from the current fixed-function state,
+    // so this drops into the same frame code as CubeRenderer.
+    void draw() const;
+
+private:
+    unsigned program = 0, vertexArray = 0;
+    unsigned vertexBuffer = 0, instanceBuffer = 0, indexBuffer = 0, stateTexture = 0;
+    int bodyIndices = 0, stickerIndices = 0;
+    int maxInstances = 0, instances = 0;
+    int viewLocation = -1, projectionLocation = -1, litLocation = -1, lightLocation = -1;
+};
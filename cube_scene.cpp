@@ -0,0 +1,91 @@
+#include "cube_scene.h"
+
+#include <GL/gl.h>
+#include <GL/glu.h>
+
+#include "frame_profiler.h"
+
+// Enhanced color palette with better contrast
+float colors[6][3] = {
+    {0.9f, 0.1f, 0.1f},  // Red (Front)
+    {1.0f, 0.6f, 0.0f},  // Orange (Back)
+    {0.1f, 0.8f, 0.1f},  // Green (Right)
+    {0.1f, 0.1f, 0.9f},  // Blue (Left)
+    {0.95f, 0.95f, 0.95f}, // White (Top)
+    {1.0f, 0.9f, 0.1f}   // Yellow (Bottom)
+};
+
+// Lighting setup. Light colours, enables and material are GL state that
+// persists, so this runs once at init; only the light positions depend on
+// the camera and are set per frame by positionLights.
+void setupLighting() {
+    ProfileTimer timer(PROFILE_LIGHTING);
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glEnable(GL_LIGHT1);
+    
+    // Main light
+    float light0_ambient[] = {0.3f, 0.3f, 0.3f, 1.0f};
+    float light0_diffuse[] = {0.8f, 0.8f, 0.8f, 1.0f};
+    float light0_specular[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    
+    glLightfv(GL_LIGHT0, GL_AMBIENT, light0_ambient);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, light0_diffuse);
+    glLightfv(GL_LIGHT0, GL_SPECULAR, light0_specular);
+    
+    // Fill light
+    float light1_diffuse[] = {0.4f, 0.4f, 0.4f, 1.0f};
+    
+    glLightfv(GL_LIGHT1, GL_DIFFUSE, light1_diffuse);
+    
+    // Material properties
+    float mat_specular[] = {0.3f, 0.3f, 0.3f, 1.0f};
+    float mat_shininess[] = {20.0f};
+    
+    glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
+    glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
+}
+
+// Light positions are transformed by the modelview matrix when set, so they
+// follow the camera only if set after it each frame
+void positionLights() {
+    ProfileTimer timer(PROFILE_LIGHTING);
+    float light0_pos[] = {5.0f, 5.0f, 5.0f, 1.0f};
+    float light1_pos[] = {-3.0f, -2.0f, 4.0f, 1.0f};
+    glLightfv(GL_LIGHT0, GL_POSITION, light0_pos);
+    glLightfv(GL_LIGHT1, GL_POSITION, light1_pos);
+}
+
+void setupScene() {
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+    glEnable(GL_NORMALIZE);
+    
+    // Enhanced background gradient effect
+    glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
+    
+    // Anti-aliasing
+    glEnable(GL_LINE_SMOOTH);
+    glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+    
+    setupLighting();
+}
+
+void applyCamera(float angleX, float angleY, float distance) {
+    glLoadIdentity();
+    glTranslatef(0.0f, 0.0f, -distance);
+    glRotatef(angleX, 1.0f, 0.0f, 0.0f);
+    glRotatef(angleY, 0.0f, 1.0f, 0.0f);
+}
+
+void setProjection(int w, int h) {
+    if (h == 0) h = 1;
+    float ratio = 1.0f * w / h;
+    
+    glViewport(0, 0, w, h);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(45.0, ratio, 1.0, 100.0);
+    glMatrixMode(GL_MODELVIEW);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// Scene setup shared by everything that renders a cube with CubeRenderer:
+// the sticker palette, GL state, lights, camera and projection. The viewer
+// and the offscreen renderer use the same calls, so their frames match.
+
+// Sticker colour of each face, in face order
+extern float colors[6][3];
+
+// One-time GL state: depth test, colour material, background and lights
+void setupScene();
+
+// Light colours, enables and material; part of setupScene
+void setupLighting();
+
+// Light positions, set every frame after the camera transform
+void positionLights();
+
+// Replace the modelview matrix with the orbit camera
+void applyCamera(float angleX, float angleY, float distance);
+
+// Viewport and 45 degree perspective for a w x h target
+void setProjection(int w, int h);
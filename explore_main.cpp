@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "cube.h"
+#include "state_space.h"
+#include "thread_pool.h"
+
+// Breadth-first exploration of a subgroup: prints the number of states at
+// every distance from solved, and optionally the distance of each scramble
+// read from stdin.
+static void printUsage(const char* program) {
+    printf("Usage: %s [options] SPACE\n", program);
+    printf("Counts the states of SPACE at every distance from solved.\n");
+    printf("  --qtm                  quarter-turn metric (default half-turn)\n");
+    printf("  --threads N            worker threads (default: all cores)\n");
+    printf("  --checkpoint FILE      resume from FILE and save progress to it\n");
+    printf("  --checkpoint-every S   seconds between checkpoints (default 60)\n");
+    printf("  --query                then read scrambles from stdin, print their distance\n");
+    printf("Spaces:\n");
+    for (const ExploreSpaceInfo& space : exploreSpaces()) printf("  %-8s %s\n", space.name, space.description);
+}
+
+int main(int argc, char** argv) {
+    const char* space = nullptr;
+    bool quarterTurns = false, query = false;
+    int threads = 0;
+    ExploreOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--qtm") == 0) quarterTurns = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) options.checkpoint = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) options.checkpointSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--query") == 0) query = true;
+        else if (argv[i][0] != '-' && !space) space = argv[i];
+        else {
+            printUsage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    StateSpaceExplorer explorer;
+    if (!space || !explorer.init(space, quarterTurns)) {
+        if (space) fprintf(stderr, "Unknown space %s\n", space);
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    WorkStealingPool pool(threads);
+    options.pool = &pool;
+    options.onLevel = [](int distance, uint64_t states, bool backward, double seconds) {
+        fprintf(stderr, "distance %2d: %12llu states  (%s, %.2f s)\n", distance, (unsigned long long)states,
+                backward ? "backward" : "forward", seconds);
+    };
+    fprintf(stderr, "%s, %s metric: %llu indices, %zu MB\n", space, quarterTurns ? "quarter-turn" : "half-turn",
+            (unsigned long long)explorer.indexCount(), explorer.memoryBytes() >> 20);
+    if (!explorer.run(options)) return 1;
+
+    const std::vector<uint64_t>& counts = explorer.levelCounts();
+    for (size_t d = 0; d < counts.size(); d++) printf("%zu\t%llu\n", d, (unsigned long long)counts[d]);
+    printf("total\t%llu\n", (unsigned long long)explorer.reached());
+
+    if (query) {
+        char* line = nullptr;
+        size_t capacity = 0;
+        ssize_t length;
+        std::vector<int> moves;
+        while ((length = getline(&line, &capacity, stdin)) != -1) {
+            while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+            const char* p = line;
+            if (!parseAlgorithm(p, line + length, moves)) {
+                printf("error: invalid move at column %d\n", (int)(p - line) + 1);
+                continue;
+            }
+            CubeState state = solvedCubeState();
+            applyMoves(state, moves.data(), moves.size());
+            int d = explorer.distance(state);
+            if (d < 0) printf("not in %s\n", space);
+            else printf("%d\n", d);
+        }
+        free(line);
+    }
+    return 0;
+}
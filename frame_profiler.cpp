@@ -0,0 +1,94 @@
+#include "frame_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+const char* const profileSectionNames[PROFILE_SECTION_COUNT] = {
+    "frame", "display", "lighting", "draw cube", "face turns",
+};
+
+const char* const profileCounterNames[PROFILE_COUNTER_COUNT] = {
+    "draw calls", "vertices",
+};
+
+FrameProfiler frameProfiler;
+
+static double milliseconds(FrameProfiler::Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+void FrameProfiler::setEnabled(bool enable) {
+    if (enable && !on) {
+        history.assign(HISTORY, Frame());
+        recorded = 0;
+        current = Frame();
+        frameStart = Clock::time_point();
+    }
+    on = enable;
+}
+
+void FrameProfiler::beginFrame(bool continuous) {
+    if (!on) return;
+    Clock::time_point now = Clock::now();
+    if (continuous && frameStart != Clock::time_point()) {
+        current.time[PROFILE_FRAME] = now - frameStart;
+        current.timed = true;
+    }
+    frameStart = now;
+}
+
+void FrameProfiler::endFrame() {
+    if (!on) return;
+    history[recorded % HISTORY] = current;
+    recorded++;
+    current = Frame();
+}
+
+// Nearest-rank percentiles of the frames that measured the section
+FrameProfiler::Percentiles FrameProfiler::percentiles(ProfileSection section) const {
+    std::vector<double> samples;
+    samples.reserve(frames());
+    for (int i = 0; i < frames(); i++) {
+        const Frame& frame = recordedFrame(i);
+        if (section != PROFILE_FRAME || frame.timed) samples.push_back(milliseconds(frame.time[section]));
+    }
+    Percentiles result;
+    result.samples = samples.size();
+    if (samples.empty()) return result;
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&](double p) { return samples[std::max<size_t>(1, ceil(p * samples.size())) - 1]; };
+    result.p50 = rank(0.50);
+    result.p90 = rank(0.90);
+    result.p99 = rank(0.99);
+    result.max = samples.back();
+    return result;
+}
+
+double FrameProfiler::averageCount(ProfileCounter counter) const {
+    if (frames() == 0) return 0.0;
+    uint64_t total = 0;
+    for (int i = 0; i < frames(); i++) total += recordedFrame(i).count[counter];
+    return (double)total / frames();
+}
+
+bool FrameProfiler::dump(const char* path) const {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+    fprintf(out, "frame");
+    for (const char* name : profileSectionNames) fprintf(out, ",%s ms", name);
+    for (const char* name : profileCounterNames) fprintf(out, ",%s", name);
+    fprintf(out, "\n");
+    for (int i = 0; i < frames(); i++) {
+        const Frame& frame = recordedFrame(i);
+        fprintf(out, "%llu", (unsigned long long)(recorded - frames() + i));
+        for (int s = 0; s < PROFILE_SECTION_COUNT; s++) {
+            // An unmeasured frame time is left empty
+            if (s == PROFILE_FRAME && !frame.timed) fprintf(out, ",");
+            else fprintf(out, ",%.4f", milliseconds(frame.time[s]));
+        }
+        for (uint64_t count : frame.count) fprintf(out, ",%llu", (unsigned long long)count);
+        fprintf(out, "\n");
+    }
+    return fclose(out) == 0;
+}
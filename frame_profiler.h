@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-frame instrumentation of the render loop: scoped timers round the
+// stages of a frame and counters of the GL work submitted, kept for the last
+// FrameProfiler::HISTORY frames for percentiles and dumps. Profiling is off
+// until enabled; a disabled timer or counter is a branch on one flag and
+// never reads the clock. Not thread-safe: timers and counters belong to the
+// thread that renders.
+
+enum ProfileSection {
+    PROFILE_FRAME,          // start of one frame to the start of the next
+    PROFILE_DISPLAY,        // the whole display callback
+    PROFILE_LIGHTING,       // light setup and positioning
+    PROFILE_DRAW_CUBE,      // colour upload and draw of the cube
+    PROFILE_FACE_TURNS,     // applying finished face turns to the state
+    PROFILE_SECTION_COUNT
+};
+
+enum ProfileCounter {
+    PROFILE_DRAW_CALLS,     // draw calls issued by the cube renderers
+    PROFILE_VERTICES,       // vertices those calls submit, instances included
+    PROFILE_COUNTER_COUNT
+};
+
+extern const char* const profileSectionNames[PROFILE_SECTION_COUNT];
+extern const char* const profileCounterNames[PROFILE_COUNTER_COUNT];
+
+class FrameProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static const int HISTORY = 1024;
+
+    // Milliseconds over the recorded frames
+    struct Percentiles {
+        int samples = 0;
+        double p50 = 0, p90 = 0, p99 = 0, max = 0;
+    };
+
+    bool enabled() const { return on; }
+
+    // Turning profiling on starts a fresh history
+    void setEnabled(bool enable);
+
+    // Bracket each frame. Work recorded between frames counts towards the
+    // next one. The frame time is measured only when continuous, that is
+    // when this frame follows the previous one without waiting for input,
+    // so idle gaps stay out of the percentiles.
+    void beginFrame(bool continuous);
+    void endFrame();
+
+    void addTime(ProfileSection section, Clock::duration elapsed) { current.time[section] += elapsed; }
+    void addCount(ProfileCounter counter, uint64_t count) { current.count[counter] += count; }
+
+    int frames() const { return recorded < HISTORY ? (int)recorded : HISTORY; }
+    Percentiles percentiles(ProfileSection section) const;
+    double averageCount(ProfileCounter counter) const;
+
+    // Write the recorded frames, oldest first, as CSV with one column per
+    // section in milliseconds and one per counter. Returns false if the file
+    // cannot be written.
+    bool dump(const char* path) const;
+
+private:
+    struct Frame {
+        Clock::duration time[PROFILE_SECTION_COUNT] = {};
+        uint64_t count[PROFILE_COUNTER_COUNT] = {};
+        bool timed = false;             // whether time[PROFILE_FRAME] was measured
+    };
+
+    const Frame& recordedFrame(int i) const { return history[(recorded - frames() + i) % HISTORY]; }
+
+    bool on = false;
+    Frame current;
+    std::vector<Frame> history;         // ring of the last HISTORY frames
+    uint64_t recorded = 0;
+    Clock::time_point frameStart;
+};
+
+extern FrameProfiler frameProfiler;
+
+// Adds the time from construction to destruction to a section
+class ProfileTimer {
+public:
+    explicit ProfileTimer(ProfileSection section) : section(section), active(frameProfiler.enabled()) {
+        if (active) start = FrameProfiler::Clock::now();
+    }
+    ~ProfileTimer() {
+        if (active) frameProfiler.addTime(section, FrameProfiler::Clock::now() - start);
+    }
+    ProfileTimer(const ProfileTimer&) = delete;
+    ProfileTimer& operator=(const ProfileTimer&) = delete;
+
+private:
+    ProfileSection section;
+    bool active;
+    FrameProfiler::Clock::time_point start;
+};
+
+inline void profileCount(ProfileCounter counter, uint64_t count) {
+    if (frameProfiler.enabled()) frameProfiler.addCount(counter, count);
+}
@@ -0,0 +1,289 @@
+#include "move_log.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+const char LOG_MAGIC[8] = {'R', 'C', 'M', 'O', 'V', 'L', 'O', 'G'};
+const uint32_t LOG_VERSION = 1;
+const size_t LOG_HEADER_BYTES = 16;             // magic, version, keyframe interval
+const size_t KEYFRAME_BYTES = (54 * 3 + 7) / 8;
+const size_t CHUNK_HEADER_BYTES = 8 + KEYFRAME_BYTES;   // move count, payload bytes, keyframe
+const int MOVE_BITS = 5;
+const int ESCAPE_CODE = 31;                     // followed by a 7-bit notation move
+const int ESCAPED_MOVE_BITS = 7;
+const int MOVES_PER_TEXT_LINE = 20;
+
+void putLittleEndian(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) p[i] = value >> (8 * i);
+}
+
+uint32_t getLittleEndian(const uint8_t* p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Bit streams are little-endian: bit i is bit i % 8 of byte i / 8
+void putBits(std::vector<uint8_t>& bytes, size_t& bit, uint32_t value, int count) {
+    for (int i = 0; i < count; i++, bit++) {
+        if (bit / 8 >= bytes.size()) bytes.push_back(0);
+        if (value >> i & 1) bytes[bit / 8] |= 1 << bit % 8;
+    }
+}
+
+uint32_t getBits(const uint8_t* bytes, size_t& bit, int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; i++, bit++) value |= (uint32_t)(bytes[bit / 8] >> bit % 8 & 1) << i;
+    return value;
+}
+
+void appendMove(std::vector<uint8_t>& bytes, size_t& bit, int move) {
+    if (move < MOVE_COUNT) {
+        putBits(bytes, bit, move, MOVE_BITS);
+    } else {
+        putBits(bytes, bit, ESCAPE_CODE, MOVE_BITS);
+        putBits(bytes, bit, move, ESCAPED_MOVE_BITS);
+    }
+}
+
+// The next move of a packed stream; -1 if it is malformed or runs past
+// bitCount
+int nextMove(const uint8_t* bytes, size_t& bit, size_t bitCount) {
+    if (bit + MOVE_BITS > bitCount) return -1;
+    int code = getBits(bytes, bit, MOVE_BITS);
+    if (code < MOVE_COUNT) return code;
+    if (code != ESCAPE_CODE || bit + ESCAPED_MOVE_BITS > bitCount) return -1;
+    int move = getBits(bytes, bit, ESCAPED_MOVE_BITS);
+    return move >= MOVE_COUNT && move < NOTATION_MOVE_COUNT ? move : -1;
+}
+
+void packKeyframe(const CubeState& state, uint8_t* out) {
+    std::vector<uint8_t> bytes;
+    size_t bit = 0;
+    for (int i = 0; i < 54; i++) putBits(bytes, bit, state.sticker[i], 3);
+    memcpy(out, bytes.data(), KEYFRAME_BYTES);
+}
+
+bool unpackKeyframe(const uint8_t* in, CubeState& state) {
+    memset(&state, 0, sizeof(state));
+    size_t bit = 0;
+    for (int i = 0; i < 54; i++) {
+        state.sticker[i] = getBits(in, bit, 3);
+        if (state.sticker[i] >= 6) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool MoveLogWriter::create(const char* path, const CubeState& start, int keyframeInterval) {
+    close();
+    file = fopen(path, "wb");
+    if (!file) return false;
+    uint8_t header[LOG_HEADER_BYTES];
+    memcpy(header, LOG_MAGIC, 8);
+    putLittleEndian(header + 8, LOG_VERSION);
+    putLittleEndian(header + 12, keyframeInterval);
+    interval = std::max(1, keyframeInterval);
+    keyframe = current = start;
+    keyframeWritten = false;
+    pending.clear();
+    written = 0;
+    failed = fwrite(header, 1, sizeof(header), file) != sizeof(header) || fflush(file) != 0;
+    return !failed;
+}
+
+void MoveLogWriter::push(int move) {
+    if (!file || move < 0 || move >= NOTATION_MOVE_COUNT) return;
+    pending.push_back(move);
+    applyMove(current, move);
+    if ((int)pending.size() >= interval) writeChunk();
+}
+
+void MoveLogWriter::push(const int* moves, int count) {
+    for (int i = 0; i < count; i++) push(moves[i]);
+}
+
+void MoveLogWriter::jump(const CubeState& state) {
+    if (!file || state == current) return;
+    if (!pending.empty()) writeChunk();
+    keyframe = current = state;
+    keyframeWritten = false;
+}
+
+// One chunk per fwrite, flushed, so readers never see half a chunk unless
+// the process dies inside the write
+bool MoveLogWriter::writeChunk() {
+    std::vector<uint8_t> chunk(CHUNK_HEADER_BYTES);
+    size_t bit = chunk.size() * 8;
+    for (int move : pending) appendMove(chunk, bit, move);
+    putLittleEndian(&chunk[0], pending.size());
+    putLittleEndian(&chunk[4], chunk.size() - CHUNK_HEADER_BYTES);
+    packKeyframe(keyframe, &chunk[8]);
+    if (fwrite(chunk.data(), 1, chunk.size(), file) != chunk.size() || fflush(file) != 0) failed = true;
+    written += pending.size();
+    pending.clear();
+    keyframe = current;
+    keyframeWritten = true;
+    return !failed;
+}
+
+bool MoveLogWriter::flush() {
+    if (!file) return false;
+    if (!pending.empty() || !keyframeWritten) writeChunk();
+    return !failed;
+}
+
+bool MoveLogWriter::close() {
+    if (!file) return false;
+    bool ok = flush();
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool MoveLog::load(const char* path) {
+    data.clear();
+    chunks.clear();
+    moves = 0;
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buffer[1 << 16];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), f)) > 0) data.insert(data.end(), buffer, buffer + got);
+    bool readError = ferror(f);
+    fclose(f);
+    if (readError || data.size() < LOG_HEADER_BYTES || memcmp(data.data(), LOG_MAGIC, 8) != 0 ||
+        getLittleEndian(&data[8]) != LOG_VERSION) {
+        return false;
+    }
+    size_t offset = LOG_HEADER_BYTES;
+    while (offset + CHUNK_HEADER_BYTES <= data.size()) {
+        Chunk chunk;
+        chunk.firstMove = moves;
+        chunk.moveCount = getLittleEndian(&data[offset]);
+        size_t payloadBytes = getLittleEndian(&data[offset + 4]);
+        chunk.payload = offset + CHUNK_HEADER_BYTES;
+        if (chunk.payload + payloadBytes > data.size()) break;      // torn off
+        if (!unpackKeyframe(&data[offset + 8], chunk.keyframe)) return false;
+        size_t bit = 0, bitCount = payloadBytes * 8;
+        for (uint32_t i = 0; i < chunk.moveCount; i++) {
+            if (nextMove(&data[chunk.payload], bit, bitCount) < 0) return false;
+        }
+        if ((bit + 7) / 8 != payloadBytes) return false;
+        chunks.push_back(chunk);
+        moves += chunk.moveCount;
+        offset = chunk.payload + payloadBytes;
+    }
+    data.resize(offset);
+    return true;
+}
+
+// The last chunk starting at or before move k
+size_t MoveLog::chunkAt(uint64_t k) const {
+    auto after = std::upper_bound(chunks.begin(), chunks.end(), k,
+                                  [](uint64_t move, const Chunk& c) { return move < c.firstMove; });
+    return after == chunks.begin() ? 0 : after - chunks.begin() - 1;
+}
+
+void MoveLog::seek(uint64_t k, CubeState& state) const {
+    if (chunks.empty()) {
+        state = solvedCubeState();
+        return;
+    }
+    const Chunk& chunk = chunks[chunkAt(std::min(k, moves))];
+    state = chunk.keyframe;
+    std::vector<int> since;
+    read(chunk.firstMove, std::min(k, moves) - chunk.firstMove, since);
+    applyMoves(state, since.data(), since.size());
+}
+
+uint64_t MoveLog::nextKeyframe(uint64_t k) const {
+    auto after = std::upper_bound(chunks.begin(), chunks.end(), k,
+                                  [](uint64_t move, const Chunk& c) { return move < c.firstMove; });
+    return after == chunks.end() ? moves : after->firstMove;
+}
+
+void MoveLog::read(uint64_t first, uint64_t count, std::vector<int>& out) const {
+    out.clear();
+    if (first >= moves) return;
+    uint64_t last = first + std::min(count, moves - first);
+    for (size_t c = chunkAt(first); c < chunks.size() && chunks[c].firstMove < last; c++) {
+        const Chunk& chunk = chunks[c];
+        size_t bit = 0;
+        for (uint64_t i = chunk.firstMove; i < chunk.firstMove + chunk.moveCount && i < last; i++) {
+            int move = nextMove(&data[chunk.payload], bit, (data.size() - chunk.payload) * 8);
+            if (i >= first) out.push_back(move);
+        }
+    }
+}
+
+bool MoveLog::exportText(FILE* out) const {
+    fprintf(out, "# %llu moves\n", (unsigned long long)moves);
+    CubeState state = solvedCubeState();
+    std::vector<int> chunkMoves;
+    std::vector<char> line(MOVES_PER_TEXT_LINE * 4 + 1);
+    for (const Chunk& chunk : chunks) {
+        if (chunk.keyframe != state) {
+            char letters[55];
+            for (int i = 0; i < 54; i++) letters[i] = faceLetters[chunk.keyframe.sticker[i]];
+            letters[54] = '\0';
+            fprintf(out, "# state %s\n", letters);
+            state = chunk.keyframe;
+        }
+        read(chunk.firstMove, chunk.moveCount, chunkMoves);
+        applyMoves(state, chunkMoves.data(), chunkMoves.size());
+        for (size_t i = 0; i < chunkMoves.size(); i += MOVES_PER_TEXT_LINE) {
+            int count = std::min<size_t>(MOVES_PER_TEXT_LINE, chunkMoves.size() - i);
+            int length = formatMoves(&chunkMoves[i], count, line.data());
+            fprintf(out, "%.*s\n", length, line.data());
+        }
+    }
+    return !ferror(out);
+}
+
+bool importMoveLogText(FILE* in, MoveLogWriter& writer, int& errorLine, int& errorColumn) {
+    char* line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    std::vector<int> moves;
+    bool ok = true;
+    errorLine = 0;
+    while (ok && (length = getline(&line, &capacity, in)) != -1) {
+        errorLine++;
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+        const char* end = line + length;
+        if (length > 0 && line[0] == '#') {
+            const char* prefix = "# state ";
+            if (length < (ssize_t)strlen(prefix) || strncmp(line, prefix, strlen(prefix)) != 0) continue;
+            const char* p = line + strlen(prefix);
+            CubeState state = solvedCubeState();
+            int i = 0;
+            for (; i < 54 && p < end; i++, p++) {
+                const char* letter = *p ? strchr(faceLetters, *p) : nullptr;
+                if (!letter) break;
+                state.sticker[i] = letter - faceLetters;
+            }
+            while (i == 54 && p < end && isspace((unsigned char)*p)) p++;
+            if (i < 54 || p != end) {
+                errorColumn = (int)(p - line) + 1;
+                ok = false;
+            } else {
+                writer.jump(state);
+            }
+            continue;
+        }
+        const char* p = line;
+        if (!parseAlgorithm(p, end, moves)) {
+            errorColumn = (int)(p - line) + 1;
+            ok = false;
+        } else {
+            writer.push(moves.data(), moves.size());
+        }
+    }
+    free(line);
+    return ok;
+}
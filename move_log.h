@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "cube.h"
+
+// Replay logs: compact binary records of a session's moves on a 3x3, for
+// playback and seeking. A log is a 16-byte file header followed by chunks,
+// each of which is a keyframe (the full state, 3 bits a sticker) and the
+// moves made from it, packed 5 bits to a move: face turns are codes 0-17,
+// and code 31 escapes to a 7-bit notation move (cube.h). A state that is
+// not reached by a move, such as a reset, starts a new chunk.
+//
+// Chunks are written whole and only ever appended, so a log being recorded
+// can be read at any time and a crash loses at most the moves not yet
+// flushed. A writer holds moves in memory until it writes their chunk: when
+// the keyframe interval fills, on flush() and on close(). Every flush()
+// with moves pending writes a chunk and its keyframe (29 bytes), so a
+// recorder that must not lose moves flushes on a timer rather than after
+// every move; the viewer flushes a second after each change.
+//
+// The state after any move k is the keyframe at or before k plus the moves
+// since, so seeking costs at most one keyframe interval of moves whatever
+// the length of the log.
+
+const int MOVE_LOG_KEYFRAME_INTERVAL = 1024;
+
+class MoveLogWriter {
+public:
+    MoveLogWriter() = default;
+    MoveLogWriter(const MoveLogWriter&) = delete;
+    MoveLogWriter& operator=(const MoveLogWriter&) = delete;
+    ~MoveLogWriter() { close(); }
+
+    // Start a new log at path from the given state, replacing any file there.
+    // A keyframe is written every keyframeInterval moves.
+    bool create(const char* path, const CubeState& start, int keyframeInterval = MOVE_LOG_KEYFRAME_INTERVAL);
+
+    bool isOpen() const { return file != nullptr; }
+
+    // Record moves in cube.h numbering
+    void push(int move);
+    void push(const int* moves, int count);
+
+    // Record a change of state that is not a move
+    void jump(const CubeState& state);
+
+    // Write the moves recorded since the last chunk. Returns false once any
+    // write has failed.
+    bool flush();
+    bool close();
+
+    uint64_t moveCount() const { return written + pending.size(); }
+    const CubeState& state() const { return current; }
+
+private:
+    bool writeChunk();
+
+    FILE* file = nullptr;
+    int interval = MOVE_LOG_KEYFRAME_INTERVAL;
+    CubeState keyframe, current;
+    bool keyframeWritten = false;
+    std::vector<int> pending;           // moves made from keyframe
+    uint64_t written = 0;
+    bool failed = false;
+};
+
+// A log loaded for playback. The moves stay packed in memory.
+class MoveLog {
+public:
+    // Read a log file. A chunk torn off by a crash while recording is
+    // dropped; anything else malformed fails the load.
+    bool load(const char* path);
+
+    uint64_t moveCount() const { return moves; }
+    size_t keyframeCount() const { return chunks.size(); }
+    size_t fileBytes() const { return data.size(); }
+
+    // The state after the first k moves (k up to moveCount), including any
+    // jump recorded right after move k
+    void seek(uint64_t k, CubeState& state) const;
+
+    // The first keyframe after move k, or moveCount if there is none
+    uint64_t nextKeyframe(uint64_t k) const;
+
+    // Moves first to first + count - 1, clipped to the log
+    void read(uint64_t first, uint64_t count, std::vector<int>& out) const;
+
+    // Write the log as notation text: the moves, one keyframe chunk per
+    // block of lines, with "# state" lines of 54 face letters (CubeState
+    // order) wherever the state does not follow from the moves before
+    bool exportText(FILE* out) const;
+
+private:
+    struct Chunk {
+        uint64_t firstMove;
+        uint32_t moveCount;
+        size_t payload;                 // offset of the packed moves in data
+        CubeState keyframe;
+    };
+
+    size_t chunkAt(uint64_t k) const;
+
+    std::vector<uint8_t> data;
+    std::vector<Chunk> chunks;
+    uint64_t moves = 0;
+};
+
+// Record notation text in the format exportText writes: moves in any
+// notation parseAlgorithm takes, "# state" lines for jumps and other '#'
+// lines as comments. On malformed text returns false with the 1-based line
+// and column of the error.
+bool importMoveLogText(FILE* in, MoveLogWriter& writer, int& errorLine, int& errorColumn);
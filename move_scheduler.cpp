@@ -0,0 +1,70 @@
+#include "move_scheduler.h"
+
+#include "cube_nxn.h"
+
+// Final layer angle of each kind of move; a clockwise quarter turn is +90
+static const float MOVE_ANGLES[3] = {90.0f, 180.0f, -90.0f};
+
+MoveScheduler::Clock::duration MoveScheduler::duration(int move) const {
+    double quarterTurns = move % 3 == 1 ? 2.0 : 1.0;
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(quarterTurns / turnsPerSecond));
+}
+
+void MoveScheduler::setSpeed(double speed, Clock::time_point now) {
+    if (speed <= 0.0) return;
+    if (queue.empty()) {
+        turnsPerSecond = speed;
+        return;
+    }
+    // Rescale the elapsed part of the current move so it keeps its progress
+    auto elapsed = std::chrono::duration<double>(now - start) * (turnsPerSecond / speed);
+    turnsPerSecond = speed;
+    start = now - std::chrono::duration_cast<Clock::duration>(elapsed);
+}
+
+void MoveScheduler::push(int move, Clock::time_point now) {
+    if (queue.empty()) {
+        start = now;
+        currentAngle = 0.0f;
+    }
+    queue.push_back(move);
+}
+
+void MoveScheduler::push(const int* moves, int count, Clock::time_point now) {
+    for (int i = 0; i < count; i++) push(moves[i], now);
+}
+
+void MoveScheduler::clear() {
+    queue.clear();
+    currentAngle = 0.0f;
+}
+
+template <typename CubeType>
+void MoveScheduler::advanceCube(CubeType& cube, Clock::time_point now, std::vector<int>* applied) {
+    while (!queue.empty()) {
+        int move = queue.front();
+        Clock::duration length = duration(move);
+        Clock::duration elapsed = now - start;
+        if (elapsed < length) {
+            // Ease in and out; the rate stays one move per duration
+            float t = std::chrono::duration<float>(elapsed) / std::chrono::duration<float>(length);
+            if (t < 0.0f) t = 0.0f;
+            currentAngle = MOVE_ANGLES[move % 3] * t * t * (3.0f - 2.0f * t);
+            return;
+        }
+        cube.apply(move);
+        if (applied) applied->push_back(move);
+        queue.pop_front();
+        start += length;
+    }
+    currentAngle = 0.0f;
+}
+
+void MoveScheduler::advance(Cube& cube, Clock::time_point now, std::vector<int>* applied) {
+    advanceCube(cube, now, applied);
+}
+
+void MoveScheduler::advance(BigCube& cube, Clock::time_point now, std::vector<int>* applied) {
+    advanceCube(cube, now, applied);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "cube.h"
+
+class BigCube;
+
+// Time-based playback of queued moves on a Cube, or layer turns (cube_nxn.h)
+// on a BigCube. Moves are animated one after another at a fixed rate
+// measured on the monotonic clock, so playback speed does not depend on the
+// frame rate, and moves queued while another is turning wait their turn
+// instead of being dropped. A move is applied to the cube when its
+// animation finishes; frames that arrive late apply every move that
+// finished in between, so a slow frame never slows the rate down.
+class MoveScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit MoveScheduler(double turnsPerSecond = 4.0) : turnsPerSecond(turnsPerSecond) {}
+
+    // Playback rate in quarter turns per second; a half turn takes twice as
+    // long. The move in progress keeps its progress.
+    void setSpeed(double turnsPerSecond, Clock::time_point now = Clock::now());
+    double speed() const { return turnsPerSecond; }
+
+    void push(int move, Clock::time_point now = Clock::now());
+    void push(const int* moves, int count, Clock::time_point now = Clock::now());
+
+    // Drop every queued move, including the one being animated
+    void clear();
+
+    bool idle() const { return queue.empty(); }
+    size_t pending() const { return queue.size(); }
+
+    // Advance playback to now, applying every move whose animation finished;
+    // applied, when given, receives those moves in order
+    void advance(Cube& cube, Clock::time_point now = Clock::now(), std::vector<int>* applied = nullptr);
+    void advance(BigCube& cube, Clock::time_point now = Clock::now(), std::vector<int>* applied = nullptr);
+
+    // The face turning, its layer and its angle in degrees as of the last
+    // advance, in the sense CubeRenderer::draw takes them; face is -1 when
+    // nothing is turning
+    int face() const { return queue.empty() ? -1 : queue.front() / 3 % 6; }
+    int layer() const { return queue.empty() ? 0 : queue.front() / 18; }
+    float angle() const { return currentAngle; }
+
+private:
+    Clock::duration duration(int move) const;
+
+    template <typename CubeType>
+    void advanceCube(CubeType& cube, Clock::time_point now, std::vector<int>* applied);
+
+    std::deque<int> queue;          // front is the move being animated
+    Clock::time_point start;        // when the front move started turning
+    double turnsPerSecond;
+    float currentAngle = 0.0f;
+};
@@ -0,0 +1,74 @@
+#include "offscreen.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <cstdio>
+#include <cstring>
+
+OffscreenContext::~OffscreenContext() {
+    if (!display) return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface) eglDestroySurface(display, surface);
+    if (context) eglDestroyContext(display, context);
+    eglTerminate(display);
+}
+
+bool OffscreenContext::create(int width, int height) {
+    // Surfaceless needs no X server or DRM device; the default display is
+    // the fallback for EGL implementations without the Mesa extension
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    if (getPlatformDisplay) dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, nullptr, nullptr)) {
+        dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, nullptr, nullptr)) {
+            fprintf(stderr, "No EGL display available\n");
+            return false;
+        }
+    }
+    display = dpy;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "EGL has no desktop OpenGL support\n");
+        return false;
+    }
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configs = 0;
+    if (!eglChooseConfig(dpy, configAttributes, &config, 1, &configs) || configs == 0) {
+        fprintf(stderr, "No EGL config with an RGB pbuffer and depth buffer\n");
+        return false;
+    }
+    context = eglCreateContext(dpy, config, EGL_NO_CONTEXT, nullptr);
+    const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    surface = eglCreatePbufferSurface(dpy, config, surfaceAttributes);
+    if (context == EGL_NO_CONTEXT || surface == EGL_NO_SURFACE ||
+        !eglMakeCurrent(dpy, surface, surface, context)) {
+        fprintf(stderr, "Failed to create a %dx%d EGL pbuffer (error 0x%x)\n", width, height, eglGetError());
+        return false;
+    }
+    surfaceWidth = width;
+    surfaceHeight = height;
+    return true;
+}
+
+void OffscreenContext::readPixels(std::vector<uint8_t>& rgb) const {
+    size_t stride = (size_t)surfaceWidth * 3;
+    rgb.resize(stride * surfaceHeight);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, surfaceWidth, surfaceHeight, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+    // GL returns the bottom row first; flip in place so rows are top-down
+    std::vector<uint8_t> row(stride);
+    for (int top = 0, bottom = surfaceHeight - 1; top < bottom; top++, bottom--) {
+        memcpy(row.data(), &rgb[top * stride], stride);
+        memcpy(&rgb[top * stride], &rgb[bottom * stride], stride);
+        memcpy(&rgb[bottom * stride], row.data(), stride);
+    }
+}
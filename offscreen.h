@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Headless GL context for rendering without a window or display server.
+// Uses EGL's surfaceless platform (Mesa) with a pbuffer, falling back to the
+// default EGL display, so it runs on CPU-only hosts through llvmpipe as well
+// as on GPUs. The context is compatibility-profile GL, so the fixed-function
+// scene setup of cube_scene.h and both cube renderers work unchanged.
+class OffscreenContext {
+public:
+    OffscreenContext() = default;
+    OffscreenContext(const OffscreenContext&) = delete;
+    OffscreenContext& operator=(const OffscreenContext&) = delete;
+    ~OffscreenContext();
+
+    // Create a width x height RGB surface with a depth buffer and make it
+    // current on the calling thread. Returns false (with a message on stderr)
+    // if no suitable EGL display or config is available.
+    bool create(int width, int height);
+
+    int width() const { return surfaceWidth; }
+    int height() const { return surfaceHeight; }
+
+    // Read the finished frame as tightly packed RGB24 rows, top row first
+    void readPixels(std::vector<uint8_t>& rgb) const;
+
+private:
+    void* display = nullptr;
+    void* context = nullptr;
+    void* surface = nullptr;
+    int surfaceWidth = 0, surfaceHeight = 0;
+};
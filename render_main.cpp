@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include <GL/gl.h>
+
+#include "cube.h"
+#include "cube_nxn.h"
+#include "cube_renderer.h"
+#include "cube_scene.h"
+#include "frame_profiler.h"
+#include "offscreen.h"
+#include "thread_pool.h"
+
+// Headless renderer: every input line is a scramble, rendered from the solved
+// cube with the viewer's scene setup into an offscreen context. Frames are
+// written as numbered PNG files or streamed as raw RGB24 to stdout, e.g.
+//   rubiks_render --raw --size 640x480 < scrambles.txt |
+//       ffmpeg -f rawvideo -pix_fmt rgb24 -s 640x480 -r 30 -i - out.mp4
+struct RenderOptions {
+    int width = 640, height = 480;
+    float angleX = 25.0f, angleY = -30.0f, distance = 12.0f;   // viewer's start camera
+    int animate = 0;                    // frames per move; 0 renders only the final state
+    int cubeSize = 3;                   // NxN cube; other sizes take face turns only
+    bool raw = false;                   // RGB24 to stdout instead of PNG files
+    const char* outputDir = ".";
+    const char* input = nullptr;        // stdin when null
+    const char* profile = nullptr;      // per-frame timings written here when set
+};
+
+// Frames are rendered on the GL thread and then compressed on all cores
+const size_t RENDER_FRAMES_PER_BATCH = 64;
+
+static void putBigEndian(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static void appendChunk(std::vector<uint8_t>& png, const char* type, const uint8_t* data, size_t length) {
+    size_t start = png.size();
+    png.resize(start + 12 + length);
+    putBigEndian(&png[start], length);
+    memcpy(&png[start + 4], type, 4);
+    if (length) memcpy(&png[start + 8], data, length);
+    putBigEndian(&png[start + 8 + length], crc32(0, &png[start + 4], length + 4));
+}
+
+// Encode top-down RGB24 rows as a PNG. Rows are stored unfiltered and
+// deflated at the fastest level: renders are mostly flat colour, so this
+// compresses well and keeps encoding far cheaper than the render itself.
+static bool encodePng(const std::vector<uint8_t>& rgb, int width, int height, std::vector<uint8_t>& png) {
+    size_t stride = (size_t)width * 3;
+    std::vector<uint8_t> rows((stride + 1) * height);
+    for (int y = 0; y < height; y++) {
+        rows[y * (stride + 1)] = 0;
+        memcpy(&rows[y * (stride + 1) + 1], &rgb[y * stride], stride);
+    }
+    uLongf deflatedSize = compressBound(rows.size());
+    std::vector<uint8_t> deflated(deflatedSize);
+    if (compress2(deflated.data(), &deflatedSize, rows.data(), rows.size(), 1) != Z_OK) return false;
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    uint8_t header[13];
+    putBigEndian(header, width);
+    putBigEndian(header + 4, height);
+    header[8] = 8;      // bit depth
+    header[9] = 2;      // truecolour
+    header[10] = header[11] = header[12] = 0;
+    png.assign(signature, signature + 8);
+    appendChunk(png, "IHDR", header, sizeof(header));
+    appendChunk(png, "IDAT", deflated.data(), deflatedSize);
+    appendChunk(png, "IEND", nullptr, 0);
+    return true;
+}
+
+class FrameWriter {
+public:
+    explicit FrameWriter(const RenderOptions& options) : options(options) {}
+
+    std::vector<uint8_t>& nextFrame() {
+        if (pending == frames.size()) frames.emplace_back();
+        return frames[pending++];
+    }
+
+    // Write every pending frame; returns false on an I/O error
+    bool flush() {
+        if (options.raw) {
+            for (size_t i = 0; i < pending; i++) {
+                if (fwrite(frames[i].data(), 1, frames[i].size(), stdout) != frames[i].size()) return false;
+            }
+        } else {
+            std::atomic<bool> ok{true};
+            WorkStealingPool::shared().parallelFor(pending, [&](size_t i) {
+                static thread_local std::vector<uint8_t> png;
+                char path[4096];
+                snprintf(path, sizeof(path), "%s/frame_%06zu.png", options.outputDir, written + i);
+                FILE* file = nullptr;
+                if (!encodePng(frames[i], options.width, options.height, png) ||
+                    !(file = fopen(path, "wb")) || fwrite(png.data(), 1, png.size(), file) != png.size()) {
+                    ok.store(false, std::memory_order_relaxed);
+                }
+                if (file && fclose(file) != 0) ok.store(false, std::memory_order_relaxed);
+            });
+            if (!ok.load()) return false;
+        }
+        written += pending;
+        pending = 0;
+        return true;
+    }
+
+    bool full() const { return pending == RENDER_FRAMES_PER_BATCH; }
+    size_t count() const { return written + pending; }
+
+private:
+    const RenderOptions& options;
+    std::vector<std::vector<uint8_t>> frames;
+    size_t pending = 0, written = 0;
+};
+
+// Angle in degrees of each move at the end of its animation, in the sense the
+// viewer turns a layer for a clockwise quarter turn
+static float moveAngle(int move) {
+    static const float angles[3] = {90.0f, 180.0f, -90.0f};
+    return angles[move % 3];
+}
+
+static int renderAll(const RenderOptions& options) {
+    FILE* in = options.input ? fopen(options.input, "r") : stdin;
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", options.input);
+        return 1;
+    }
+    initMoveTables();
+    frameProfiler.setEnabled(options.profile != nullptr);
+    OffscreenContext context;
+    if (!context.create(options.width, options.height)) return 1;
+
+    setupScene();
+    setProjection(options.width, options.height);
+    CubeRenderer renderer;
+    renderer.init(colors, options.cubeSize);
+    FrameWriter writer(options);
+
+    // A 3x3 turns on the move kernels, other sizes on the NxN model
+    bool threeByThree = options.cubeSize == 3;
+    CubeState state;
+    BigCube bigCube(options.cubeSize);
+
+    // A frame's display time includes reading it back; writing the batch
+    // out counts towards the next frame
+    auto renderFrame = [&](int face, float angle, int layer) {
+        frameProfiler.beginFrame(true);
+        {
+            ProfileTimer timer(PROFILE_DISPLAY);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            applyCamera(options.angleX, options.angleY, options.distance);
+            positionLights();
+            {
+                ProfileTimer drawTimer(PROFILE_DRAW_CUBE);
+                if (threeByThree) renderer.update(state);
+                else renderer.update(bigCube);
+                renderer.draw(face, angle, layer);
+            }
+            context.readPixels(writer.nextFrame());
+        }
+        frameProfiler.endFrame();
+        return !writer.full() || writer.flush();
+    };
+
+    std::vector<int> moves;
+    char* line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    int lineNumber = 0, status = 0;
+    while (status == 0 && (length = getline(&line, &capacity, in)) != -1) {
+        lineNumber++;
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+        state = solvedCubeState();
+        bigCube.reset();
+        const char* p = line;
+        if (!parseAlgorithm(p, line + length, moves)) {
+            fprintf(stderr, "Line %d: invalid move at column %d\n", lineNumber, (int)(p - line) + 1);
+            status = 1;
+            break;
+        }
+        for (int move : moves) {
+            if (status != 0) break;
+            if (!threeByThree && move >= MOVE_COUNT) {
+                fprintf(stderr, "Line %d: only face turns are supported on a %dx%d cube\n",
+                        lineNumber, options.cubeSize, options.cubeSize);
+                status = 1;
+                break;
+            }
+            // Intermediate frames turn the layer from the last state; the
+            // final frame of the move is the next state drawn at rest. Face
+            // and slice turns animate; wide turns and rotations jump.
+            int frames = move < 36 ? options.animate : 0;
+            for (int frame = 0; frame < frames && status == 0; frame++) {
+                if (!renderFrame(move / 3 % 6, moveAngle(move) * frame / frames, move / 18)) status = 1;
+            }
+            ProfileTimer turnTimer(PROFILE_FACE_TURNS);
+            if (threeByThree) applyMove(state, move);
+            else bigCube.apply(move);
+        }
+        if (status == 0 && !renderFrame(-1, 0.0f, 0)) status = 1;
+    }
+    if (status == 0 && !writer.flush()) status = 1;
+    if (options.raw) fflush(stdout);
+    if (status == 0 && ferror(stdout)) status = 1;
+    free(line);
+    if (in != stdin) fclose(in);
+    fprintf(stderr, "%zu frames\n", writer.count());
+    if (options.profile) {
+        for (int s = 0; s < PROFILE_SECTION_COUNT; s++) {
+            FrameProfiler::Percentiles p = frameProfiler.percentiles((ProfileSection)s);
+            fprintf(stderr, "%-12s p50 %.3f  p90 %.3f  p99 %.3f  max %.3f ms\n", profileSectionNames[s],
+                    p.p50, p.p90, p.p99, p.max);
+        }
+        fprintf(stderr, "%.1f draw calls, %.0f vertices per frame\n",
+                frameProfiler.averageCount(PROFILE_DRAW_CALLS), frameProfiler.averageCount(PROFILE_VERTICES));
+        if (!frameProfiler.dump(options.profile)) {
+            fprintf(stderr, "Cannot write %s\n", options.profile);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+static void printUsage(const char* program) {
+    printf("Usage: %s [options] [file]\n", program);
+    printf("Reads one scramble per line from file or stdin and renders the\n");
+    printf("scrambled cube offscreen, one frame per line.\n");
+    printf("  --size WxH        frame size (default 640x480)\n");
+    printf("  --out DIR         directory for frame_NNNNNN.png files (default .)\n");
+    printf("  --raw             write raw RGB24 frames to stdout instead of PNG\n");
+    printf("  --camera X Y D    camera pitch, yaw and distance (default 25 -30 12)\n");
+    printf("  --animate N       also render N frames of every move being turned\n");
+    printf("  --cube N          render an NxN cube (default 3)\n");
+    printf("  --profile FILE    write per-frame timings of the last %d frames to FILE\n", FrameProfiler::HISTORY);
+}
+
+int main(int argc, char** argv) {
+    RenderOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc &&
+            sscanf(argv[i + 1], "%dx%d", &options.width, &options.height) == 2 &&
+            options.width > 0 && options.height > 0) i++;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) options.outputDir = argv[++i];
+        else if (strcmp(argv[i], "--raw") == 0) options.raw = true;
+        else if (strcmp(argv[i], "--camera") == 0 && i + 3 < argc) {
+            options.angleX = atof(argv[++i]);
+            options.angleY = atof(argv[++i]);
+            options.distance = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--animate") == 0 && i + 1 < argc) options.animate = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--cube") == 0 && i + 1 < argc) options.cubeSize = std::max(2, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) options.profile = argv[++i];
+        else if (argv[i][0] != '-' && !options.input) options.input = argv[i];
+        else {
+            printUsage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    return renderAll(options);
+}
@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "cube.h"
+#include "move_log.h"
+
+// Inspect, seek and convert replay logs.
+static void printUsage(const char* program) {
+    printf("Usage: %s [options] LOG\n", program);
+    printf("Prints the number of moves and keyframes in LOG and its size.\n");
+    printf("  --import FILE   record the notation text in FILE ('-' for stdin) as LOG\n");
+    printf("  --keyframe N    moves between keyframes when importing (default %d)\n", MOVE_LOG_KEYFRAME_INTERVAL);
+    printf("  --export        write LOG as notation text to stdout\n");
+    printf("  --seek K        print the state after move K as 54 face letters\n");
+}
+
+int main(int argc, char** argv) {
+    const char* logPath = nullptr;
+    const char* importPath = nullptr;
+    int interval = MOVE_LOG_KEYFRAME_INTERVAL;
+    bool exportText = false;
+    long long seekMove = -1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--import") == 0 && i + 1 < argc) importPath = argv[++i];
+        else if (strcmp(argv[i], "--keyframe") == 0 && i + 1 < argc) interval = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--export") == 0) exportText = true;
+        else if (strcmp(argv[i], "--seek") == 0 && i + 1 < argc) seekMove = atoll(argv[++i]);
+        else if (argv[i][0] != '-' && !logPath) logPath = argv[i];
+        else {
+            printUsage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (!logPath) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    initMoveTables();
+    if (importPath) {
+        FILE* in = strcmp(importPath, "-") == 0 ? stdin : fopen(importPath, "r");
+        if (!in) {
+            fprintf(stderr, "Cannot open %s\n", importPath);
+            return 1;
+        }
+        MoveLogWriter writer;
+        if (!writer.create(logPath, solvedCubeState(), interval)) {
+            fprintf(stderr, "Cannot create %s\n", logPath);
+            return 1;
+        }
+        int line, column;
+        bool parsed = importMoveLogText(in, writer, line, column);
+        if (in != stdin) fclose(in);
+        if (!parsed) {
+            fprintf(stderr, "%s:%d:%d: invalid move\n", importPath, line, column);
+            return 1;
+        }
+        if (!writer.close()) {
+            fprintf(stderr, "Cannot write %s\n", logPath);
+            return 1;
+        }
+    }
+
+    MoveLog log;
+    if (!log.load(logPath)) {
+        fprintf(stderr, "Cannot read the move log %s\n", logPath);
+        return 1;
+    }
+    if (exportText) return log.exportText(stdout) ? 0 : 1;
+    if (seekMove >= 0) {
+        if ((unsigned long long)seekMove > log.moveCount()) {
+            fprintf(stderr, "The log has only %llu moves\n", (unsigned long long)log.moveCount());
+            return 1;
+        }
+        CubeState state;
+        log.seek(seekMove, state);
+        for (int i = 0; i < 54; i++) putchar(faceLetters[state.sticker[i]]);
+        putchar('\n');
+        return 0;
+    }
+    printf("%llu moves, %zu keyframes, %zu bytes (%.2f bits per move)\n", (unsigned long long)log.moveCount(),
+           log.keyframeCount(), log.fileBytes(), log.moveCount() ? 8.0 * log.fileBytes() / log.moveCount() : 0.0);
+    return 0;
+}
@@ -1,9 +1,21 @@
 #include <GL/glut.h>
-#include <vector>
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
-#include <ctime>
 #include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "cube.h"
+#include "cube_nxn.h"
+#include "cube_picking.h"
+#include "cube_renderer.h"
+#include "cube_scene.h"
+#include "frame_profiler.h"
+#include "move_log.h"
+#include "move_scheduler.h"
+#include "scramble.h"
+#include "solver.h"
 
 // Enhanced camera and rotation system
 struct Camera {
@@ -15,346 +27,180 @@ struct Camera {
     bool smoothRotation = true;
 };
 
-// Face rotation animation
-struct FaceRotation {
-    int face = -1;          // 0=front, 1=back, 2=right, 3=left, 4=top, 5=bottom
-    float angle = 0.0f;
-    float targetAngle = 0.0f;
-    bool isRotating = false;
-    float speed = 5.0f;
-};
-
-// Cube state representation
-int cubeState[6][9] = {
-    {0,0,0,0,0,0,0,0,0}, // Front (Red)
-    {1,1,1,1,1,1,1,1,1}, // Back (Orange)
-    {2,2,2,2,2,2,2,2,2}, // Right (Green)
-    {3,3,3,3,3,3,3,3,3}, // Left (Blue)
-    {4,4,4,4,4,4,4,4,4}, // Top (White)
-    {5,5,5,5,5,5,5,5,5}  // Bottom (Yellow)
-};
+// Cube state representation. A 3x3 is a Cube, so the solver can take it;
+// other sizes (--size N) are a BigCube.
+int cubeSize = 3;
+Cube cube;
+BigCube bigCube;
+CubeRenderer renderer;
+
+// Face turns waiting to be animated, played at a fixed rate in quarter turns
+// per second
+MoveScheduler moveQueue(5.0);
+MoveScheduler::Clock::time_point lastFrame = MoveScheduler::Clock::now();
+
+// Replay logs (3x3 only): --record writes every move and reset of the
+// session, --replay plays a log back from its start; not both at once
+MoveLogWriter recorder;
+MoveLog replayLog;
+bool replaying = false;
+uint64_t replayNext = 0;         // next log move to queue; past the end once done
+std::vector<int> appliedMoves;
+bool recorderFlushDue = false;   // a flush timer is running
+const int RECORDER_FLUSH_MS = 1000;
 
 Camera camera;
-FaceRotation faceRotation;
 bool autoRotate = false;
 bool showHelp = false;
+bool showProfile = false;
+const char* profilePath = "rubiks_profile.csv";
+bool profileOnExit = false;      // --profile: record from the start, dump at exit
+bool redrawing = false;          // whether the last frame kept the idle loop running
 int windowWidth = 1000, windowHeight = 800;
 
-// Enhanced color palette with better contrast
-float colors[6][3] = {
-    {0.9f, 0.1f, 0.1f},  // Red (Front)
-    {1.0f, 0.6f, 0.0f},  // Orange (Back)
-    {0.1f, 0.8f, 0.1f},  // Green (Right)
-    {0.1f, 0.1f, 0.9f},  // Blue (Left)
-    {0.95f, 0.95f, 0.95f}, // White (Top)
-    {1.0f, 0.9f, 0.1f}   // Yellow (Bottom)
-};
+// Draw the cube from the retained geometry, refreshing sticker colours first
+// if the state changed
+void drawRubiksCube() {
+    ProfileTimer timer(PROFILE_DRAW_CUBE);
+    if (cubeSize == 3) renderer.update(cube.state());
+    else renderer.update(bigCube);
+    renderer.draw(moveQueue.face(), moveQueue.angle(), moveQueue.layer());
+}
 
-// Lighting setup
-void setupLighting() {
-    glEnable(GL_LIGHTING);
-    glEnable(GL_LIGHT0);
-    glEnable(GL_LIGHT1);
-    
-    // Main light
-    float light0_pos[] = {5.0f, 5.0f, 5.0f, 1.0f};
-    float light0_ambient[] = {0.3f, 0.3f, 0.3f, 1.0f};
-    float light0_diffuse[] = {0.8f, 0.8f, 0.8f, 1.0f};
-    float light0_specular[] = {1.0f, 1.0f, 1.0f, 1.0f};
-    
-    glLightfv(GL_LIGHT0, GL_POSITION, light0_pos);
-    glLightfv(GL_LIGHT0, GL_AMBIENT, light0_ambient);
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, light0_diffuse);
-    glLightfv(GL_LIGHT0, GL_SPECULAR, light0_specular);
-    
-    // Fill light
-    float light1_pos[] = {-3.0f, -2.0f, 4.0f, 1.0f};
-    float light1_diffuse[] = {0.4f, 0.4f, 0.4f, 1.0f};
-    
-    glLightfv(GL_LIGHT1, GL_POSITION, light1_pos);
-    glLightfv(GL_LIGHT1, GL_DIFFUSE, light1_diffuse);
-    
-    // Material properties
-    float mat_specular[] = {0.3f, 0.3f, 0.3f, 1.0f};
-    float mat_shininess[] = {20.0f};
-    
-    glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
-    glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
+// The recorder holds moves in memory until it writes a chunk; flush it a
+// second after the first change since the last flush, so a crash loses at
+// most a second of the session and a busy one writes a chunk a second
+void flushRecorder(int) {
+    recorderFlushDue = false;
+    recorder.flush();
 }
 
-// Draws a single colored face (sticker) given its vertices and normal
-void drawColoredFace(int colorIndex, const float v1[3], const float v2[3], const float v3[3], const float v4[3], const float normal[3]) {
-    float* color = colors[colorIndex];
-    
-    // Set material color
-    glColor3fv(color);
-    
-    // Draw the quad
-    glBegin(GL_QUADS);
-    glNormal3fv(normal);
-    glVertex3fv(v1);
-    glVertex3fv(v2);
-    glVertex3fv(v3);
-    glVertex3fv(v4);
-    glEnd();
+void recorded() {
+    if (!recorder.isOpen() || recorderFlushDue) return;
+    recorderFlushDue = true;
+    glutTimerFunc(RECORDER_FLUSH_MS, flushRecorder, 0);
 }
 
-// Draws a single cubie, consisting of a black cube body and colored stickers.
-void drawCubie(int x, int y, int z) {
-    glPushMatrix();
-    glTranslatef(x, y, z);
+void scrambleCube() {
+    moveQueue.clear();
+    if (cubeSize == 3) {
+        int moves[20];
+        randomScramble(threadScrambleRng(), moves, 20);
+        cube.apply(moves, 20);
+        recorder.push(moves, 20);
+        recorded();
+    } else {
+        bigCube.scramble(threadScrambleRng(), 10 * cubeSize);
+    }
+}
 
-    // Draw the solid black cube body
-    glDisable(GL_LIGHTING);
-    glColor3f(0.0f, 0.0f, 0.0f);
-    glutSolidCube(1.0f);
-    glEnable(GL_LIGHTING);
+// Put the 3x3 in a state no move leads to, recording it as a jump
+void setCubeState(const CubeState& state) {
+    cube = Cube(state);
+    recorder.jump(state);
+    recorded();
+}
 
-    float s = 0.5f - 0.05f; // half-size of sticker, with inset
-
-    // Front face (Z = 1)
-    if (z == 1) {
-        int row = (1 - y); int col = (x + 1); int faceIndex = row * 3 + col;
-        const float normal[] = {0, 0, 1};
-        const float v1[] = {-s, -s, 0.501f};
-        const float v2[] = { s, -s, 0.501f};
-        const float v3[] = { s,  s, 0.501f};
-        const float v4[] = {-s,  s, 0.501f};
-        drawColoredFace(cubeState[0][faceIndex], v1, v2, v3, v4, normal);
-    }
-    
-    // Back face (Z = -1)
-    if (z == -1) {
-        int row = (1 - y); int col = (1 - x); int faceIndex = row * 3 + col;
-        const float normal[] = {0, 0, -1};
-        const float v1[] = { s, -s, -0.501f};
-        const float v2[] = {-s, -s, -0.501f};
-        const float v3[] = {-s,  s, -0.501f};
-        const float v4[] = { s,  s, -0.501f};
-        drawColoredFace(cubeState[1][faceIndex], v1, v2, v3, v4, normal);
-    }
-    
-    // Top face (Y = 1)
-    if (y == 1) {
-        int row = (1 - z); int col = (x + 1); int faceIndex = row * 3 + col;
-        const float normal[] = {0, 1, 0};
-        const float v1[] = {-s, 0.501f,  s};
-        const float v2[] = { s, 0.501f,  s};
-        const float v3[] = { s, 0.501f, -s};
-        const float v4[] = {-s, 0.501f, -s};
-        drawColoredFace(cubeState[4][faceIndex], v1, v2, v3, v4, normal);
-    }
-    
-    // Bottom face (Y = -1)
-    if (y == -1) {
-        int row = (z + 1); int col = (x + 1); int faceIndex = row * 3 + col;
-        const float normal[] = {0, -1, 0};
-        const float v1[] = {-s, -0.501f, -s};
-        const float v2[] = { s, -0.501f, -s};
-        const float v3[] = { s, -0.501f,  s};
-        const float v4[] = {-s, -0.501f,  s};
-        drawColoredFace(cubeState[5][faceIndex], v1, v2, v3, v4, normal);
-    }
-    
-    // Right face (X = 1)
-    if (x == 1) {
-        int row = (1 - y); int col = (1 - z); int faceIndex = row * 3 + col;
-        const float normal[] = {1, 0, 0};
-        const float v1[] = {0.501f, -s,  s};
-        const float v2[] = {0.501f,  s,  s};
-        const float v3[] = {0.501f,  s, -s};
-        const float v4[] = {0.501f, -s, -s};
-        drawColoredFace(cubeState[2][faceIndex], v1, v2, v3, v4, normal);
-    }
-    
-    // Left face (X = -1)
-    if (x == -1) {
-        int row = (1 - y); int col = (z + 1); int faceIndex = row * 3 + col;
-        const float normal[] = {-1, 0, 0};
-        const float v1[] = {-0.501f, -s, -s};
-        const float v2[] = {-0.501f,  s, -s};
-        const float v3[] = {-0.501f,  s,  s};
-        const float v4[] = {-0.501f, -s,  s};
-        drawColoredFace(cubeState[3][faceIndex], v1, v2, v3, v4, normal);
-    }
-    
-    glPopMatrix();
+// Reset cube to solved state
+void resetCube() {
+    moveQueue.clear();
+    setCubeState(solvedCubeState());
+    bigCube.reset();
 }
 
-// Enhanced cube drawing with face rotation support
-void drawRubiksCube() {
-    for (int x = -1; x <= 1; x++) {
-        for (int y = -1; y <= 1; y++) {
-            for (int z = -1; z <= 1; z++) {
-                bool needsRotation = false;
-                
-                // Check if this cubie is part of the rotating face
-                if (faceRotation.isRotating) {
-                    switch (faceRotation.face) {
-                        case 0: needsRotation = (z == 1); break;  // Front
-                        case 1: needsRotation = (z == -1); break; // Back
-                        case 2: needsRotation = (x == 1); break;  // Right
-                        case 3: needsRotation = (x == -1); break; // Left
-                        case 4: needsRotation = (y == 1); break;  // Top
-                        case 5: needsRotation = (y == -1); break; // Bottom
-                    }
-                }
-                
-                if (needsRotation) {
-                    glPushMatrix();
-                    // Apply rotation around appropriate axis
-                    switch (faceRotation.face) {
-                        case 0: case 1: // Front/Back - rotate around Z
-                            glRotatef(faceRotation.angle, 0, 0, faceRotation.face == 0 ? 1 : -1);
-                            break;
-                        case 2: case 3: // Right/Left - rotate around X
-                            glRotatef(faceRotation.angle, faceRotation.face == 2 ? 1 : -1, 0, 0);
-                            break;
-                        case 4: case 5: // Top/Bottom - rotate around Y
-                            glRotatef(faceRotation.angle, 0, faceRotation.face == 4 ? 1 : -1, 0);
-                            break;
-                    }
-                    drawCubie(x, y, z);
-                    glPopMatrix();
-                } else {
-                    drawCubie(x, y, z);
-                }
-            }
-        }
-    }
+// Replay position: log moves applied to the cube so far
+uint64_t replayPosition() {
+    return std::min(replayNext, replayLog.moveCount()) - moveQueue.pending();
 }
 
-// Rotate a face 90 degrees clockwise in the state array
-void rotateFaceClockwise(int face) {
-    int temp[9];
-    // Copy current state
-    for (int i = 0; i < 9; i++) {
-        temp[i] = cubeState[face][i];
-    }
-    
-    // Rotate clockwise: map old positions to new positions
-    // 0 1 2    6 3 0
-    // 3 4 5 -> 7 4 1
-    // 6 7 8    8 5 2
-    cubeState[face][0] = temp[6];
-    cubeState[face][1] = temp[3];
-    cubeState[face][2] = temp[0];
-    cubeState[face][3] = temp[7];
-    cubeState[face][4] = temp[4]; // center stays
-    cubeState[face][5] = temp[1];
-    cubeState[face][6] = temp[8];
-    cubeState[face][7] = temp[5];
-    cubeState[face][8] = temp[2];
+// Once the queue has played out, restore the state the log holds at the
+// next move and queue the moves up to the following keyframe. Starting
+// from the log's own state keeps playback right across resets and after
+// seeking.
+void advanceReplay() {
+    if (!replaying || !moveQueue.idle() || replayNext > replayLog.moveCount()) return;
+    CubeState state;
+    replayLog.seek(replayNext, state);
+    setCubeState(state);
+    std::vector<int> moves;
+    replayLog.read(replayNext, replayLog.nextKeyframe(replayNext) - replayNext, moves);
+    moveQueue.push(moves.data(), moves.size());
+    replayNext += moves.empty() ? 1 : moves.size();
 }
 
-// Rotate adjacent edges when a face is rotated
-void rotateAdjacentEdges(int face) {
-    int temp[3];
-    
-    switch (face) {
-        case 0: // Front face - affects Top, Right, Bottom, Left edges
-            // Save top edge
-            temp[0] = cubeState[4][6]; temp[1] = cubeState[4][7]; temp[2] = cubeState[4][8];
-            // Top <- Left
-            cubeState[4][6] = cubeState[3][8]; cubeState[4][7] = cubeState[3][5]; cubeState[4][8] = cubeState[3][2];
-            // Left <- Bottom
-            cubeState[3][2] = cubeState[5][2]; cubeState[3][5] = cubeState[5][1]; cubeState[3][8] = cubeState[5][0];
-            // Bottom <- Right
-            cubeState[5][0] = cubeState[2][6]; cubeState[5][1] = cubeState[2][3]; cubeState[5][2] = cubeState[2][0];
-            // Right <- Top (from temp)
-            cubeState[2][0] = temp[0]; cubeState[2][3] = temp[1]; cubeState[2][6] = temp[2];
-            break;
-            
-        case 1: // Back face - affects Top, Left, Bottom, Right edges
-            // Save top edge
-            temp[0] = cubeState[4][0]; temp[1] = cubeState[4][1]; temp[2] = cubeState[4][2];
-            // Top <- Right
-            cubeState[4][0] = cubeState[2][2]; cubeState[4][1] = cubeState[2][5]; cubeState[4][2] = cubeState[2][8];
-            // Right <- Bottom
-            cubeState[2][2] = cubeState[5][8]; cubeState[2][5] = cubeState[5][7]; cubeState[2][8] = cubeState[5][6];
-            // Bottom <- Left
-            cubeState[5][6] = cubeState[3][0]; cubeState[5][7] = cubeState[3][3]; cubeState[5][8] = cubeState[3][6];
-            // Left <- Top (from temp)
-            cubeState[3][0] = temp[2]; cubeState[3][3] = temp[1]; cubeState[3][6] = temp[0];
-            break;
-            
-        case 2: // Right face - affects Top, Back, Bottom, Front edges
-            // Save top edge
-            temp[0] = cubeState[4][2]; temp[1] = cubeState[4][5]; temp[2] = cubeState[4][8];
-            // Top <- Front
-            cubeState[4][2] = cubeState[0][2]; cubeState[4][5] = cubeState[0][5]; cubeState[4][8] = cubeState[0][8];
-            // Front <- Bottom
-            cubeState[0][2] = cubeState[5][2]; cubeState[0][5] = cubeState[5][5]; cubeState[0][8] = cubeState[5][8];
-            // Bottom <- Back
-            cubeState[5][2] = cubeState[1][6]; cubeState[5][5] = cubeState[1][3]; cubeState[5][8] = cubeState[1][0];
-            // Back <- Top (from temp)
-            cubeState[1][0] = temp[2]; cubeState[1][3] = temp[1]; cubeState[1][6] = temp[0];
-            break;
-            
-        case 3: // Left face - affects Top, Front, Bottom, Back edges
-            // Save top edge
-            temp[0] = cubeState[4][0]; temp[1] = cubeState[4][3]; temp[2] = cubeState[4][6];
-            // Top <- Back
-            cubeState[4][0] = cubeState[1][8]; cubeState[4][3] = cubeState[1][5]; cubeState[4][6] = cubeState[1][2];
-            // Back <- Bottom
-            cubeState[1][2] = cubeState[5][6]; cubeState[1][5] = cubeState[5][3]; cubeState[1][8] = cubeState[5][0];
-            // Bottom <- Front
-            cubeState[5][0] = cubeState[0][0]; cubeState[5][3] = cubeState[0][3]; cubeState[5][6] = cubeState[0][6];
-            // Front <- Top (from temp)
-            cubeState[0][0] = temp[0]; cubeState[0][3] = temp[1]; cubeState[0][6] = temp[2];
-            break;
-            
-        case 4: // Top face - affects Front, Right, Back, Left edges
-            // Save front edge
-            temp[0] = cubeState[0][0]; temp[1] = cubeState[0][1]; temp[2] = cubeState[0][2];
-            // Front <- Right
-            cubeState[0][0] = cubeState[2][0]; cubeState[0][1] = cubeState[2][1]; cubeState[0][2] = cubeState[2][2];
-            // Right <- Back
-            cubeState[2][0] = cubeState[1][0]; cubeState[2][1] = cubeState[1][1]; cubeState[2][2] = cubeState[1][2];
-            // Back <- Left
-            cubeState[1][0] = cubeState[3][0]; cubeState[1][1] = cubeState[3][1]; cubeState[1][2] = cubeState[3][2];
-            // Left <- Front (from temp)
-            cubeState[3][0] = temp[0]; cubeState[3][1] = temp[1]; cubeState[3][2] = temp[2];
-            break;
-            
-        case 5: // Bottom face - affects Front, Left, Back, Right edges
-            // Save front edge
-            temp[0] = cubeState[0][6]; temp[1] = cubeState[0][7]; temp[2] = cubeState[0][8];
-            // Front <- Left
-            cubeState[0][6] = cubeState[3][6]; cubeState[0][7] = cubeState[3][7]; cubeState[0][8] = cubeState[3][8];
-            // Left <- Back
-            cubeState[3][6] = cubeState[1][6]; cubeState[3][7] = cubeState[1][7]; cubeState[3][8] = cubeState[1][8];
-            // Back <- Right
-            cubeState[1][6] = cubeState[2][6]; cubeState[1][7] = cubeState[2][7]; cubeState[1][8] = cubeState[2][8];
-            // Right <- Front (from temp)
-            cubeState[2][6] = temp[0]; cubeState[2][7] = temp[1]; cubeState[2][8] = temp[2];
-            break;
-    }
+// Jump playback by delta moves from where it is, then play on from there
+void seekReplay(int64_t delta) {
+    if (!replaying) return;
+    int64_t target = (int64_t)replayPosition() + delta;
+    target = std::max<int64_t>(0, std::min<int64_t>(target, replayLog.moveCount()));
+    moveQueue.clear();
+    CubeState state;
+    replayLog.seek(target, state);
+    setCubeState(state);
+    replayNext = target;
 }
 
-// Perform a complete face rotation (both face and adjacent edges)
-void performFaceRotation(int face) {
-    rotateFaceClockwise(face);
-    rotateAdjacentEdges(face);
+void closeRecorder() {
+    if (!recorder.close()) fprintf(stderr, "Cannot write the move log\n");
 }
 
-void scrambleCube() {
-    srand(time(nullptr));
-    for (int i = 0; i < 20; ++i) {
-        int face = rand() % 6;
-        performFaceRotation(face);
+// Queue a two-phase solution of the state the queued moves lead to, so it
+// plays back after them. Slices and rotations (a dragged middle layer) move
+// the centres; the solver needs them home, so it solves the cube recoloured
+// by its centres, and since face turns act on positions, not colours, the
+// same turns solve the cube as it stands.
+void solveCube() {
+    if (cubeSize != 3) return;
+    initTwoPhase();
+    Cube target = cube;
+    MoveScheduler pending = moveQueue;
+    pending.advance(target, MoveScheduler::Clock::time_point::max());
+    CubeState home = target.state();
+    normalizeCenters(home);
+    std::vector<int> solution;
+    if (!solveTwoPhase(home, solution)) {
+        fprintf(stderr, "Cannot solve the cube from this state\n");
+        return;
     }
+    moveQueue.push(solution.data(), solution.size());
 }
 
-// Reset cube to solved state
-void resetCube() {
-    for (int face = 0; face < 6; face++) {
-        for (int pos = 0; pos < 9; pos++) {
-            cubeState[face][pos] = face;
-        }
+// Wall-of-cubes view: WALL_SIZE x WALL_SIZE independent cubes that each take
+// a random turn every frame, drawn by the instanced renderer
+const int WALL_SIZE = 16;
+InstancedCubeRenderer wallRenderer;
+bool wallAvailable = false;
+bool showWall = false;
+std::vector<CubeState> wallStates;
+std::vector<float> wallTransforms;   // column-major 4x4 per cube
+unsigned wallSeed = 1;
+
+void initWall() {
+    wallAvailable = wallRenderer.init(colors, WALL_SIZE * WALL_SIZE);
+    if (!wallAvailable) return;
+    const float scale = 0.12f, spacing = 4.0f * scale;
+    wallStates.resize(WALL_SIZE * WALL_SIZE);
+    wallTransforms.assign(WALL_SIZE * WALL_SIZE * 16, 0.0f);
+    for (int i = 0; i < WALL_SIZE * WALL_SIZE; i++) {
+        Cube wallCube;
+        wallCube.scramble(i + 1);
+        wallStates[i] = wallCube.state();
+        float* m = &wallTransforms[i * 16];
+        m[0] = m[5] = m[10] = scale;
+        m[12] = (i % WALL_SIZE - (WALL_SIZE - 1) / 2.0f) * spacing;
+        m[13] = (i / WALL_SIZE - (WALL_SIZE - 1) / 2.0f) * spacing;
+        m[15] = 1.0f;
     }
 }
 
+void drawWall() {
+    for (CubeState& state : wallStates) {
+        applyMove(state, rand_r(&wallSeed) % MOVE_COUNT);
+    }
+    wallRenderer.update(wallStates.data(), (const float (*)[16])wallTransforms.data(), wallStates.size());
+    wallRenderer.draw();
+}
+
 // Render text
 void renderText(float x, float y, const char* text) {
     glDisable(GL_LIGHTING);
@@ -381,15 +227,8 @@ void renderText(float x, float y, const char* text) {
     glEnable(GL_LIGHTING);
 }
 
-// Display help overlay
-void displayHelp() {
-    if (!showHelp) return;
-    
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    
-    // Semi-transparent background
+// Semi-transparent black rectangle in window coordinates, for overlays
+void fillOverlay(float x0, float y0, float x1, float y1) {
     glDisable(GL_LIGHTING);
     glMatrixMode(GL_PROJECTION);
     glPushMatrix();
@@ -401,105 +240,216 @@ void displayHelp() {
     
     glColor4f(0.0f, 0.0f, 0.0f, 0.7f);
     glBegin(GL_QUADS);
-    glVertex2f(0, 0);
-    glVertex2f(windowWidth, 0);
-    glVertex2f(windowWidth, windowHeight);
-    glVertex2f(0, windowHeight);
+    glVertex2f(x0, y0);
+    glVertex2f(x1, y0);
+    glVertex2f(x1, y1);
+    glVertex2f(x0, y1);
     glEnd();
     
     glPopMatrix();
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
     glMatrixMode(GL_MODELVIEW);
+}
+
+// Display help overlay
+void displayHelp() {
+    if (!showHelp) return;
+    
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    // Semi-transparent background
+    fillOverlay(0, 0, windowWidth, windowHeight);
     
     // Help text
     renderText(50, 50, "ENHANCED RUBIK'S CUBE CONTROLS:");
     renderText(50, 80, "WASD - Rotate camera");
-    renderText(50, 100, "Mouse - Interactive camera control");
+    renderText(50, 100, "Mouse - Drag a sticker to turn its layer, elsewhere to orbit");
     renderText(50, 120, "R - Reset cube to solved state");
     renderText(50, 140, "Space - Scramble cube");
     renderText(50, 160, "A - Toggle auto-rotation");
     renderText(50, 180, "123456 - Rotate faces (Front/Back/Right/Left/Top/Bottom)");
-    renderText(50, 200, "+ / - - Zoom in/out");
-    renderText(50, 220, "H - Toggle this help");
-    renderText(50, 240, "ESC - Exit");
-    renderText(50, 280, "Press H again to close help");
+    renderText(50, 200, "V - Solve (animated, 3x3 only)   [ / ] - Slower/faster turns");
+    renderText(50, 220, "+ / - - Zoom in/out");
+    renderText(50, 240, "G - Toggle wall of live cubes");
+    renderText(50, 260, "P - Toggle frame profile   O - Write profile to file");
+    renderText(50, 280, ", / . - Replay back/forward a move   < / > - 100 moves");
+    renderText(50, 300, "H - Toggle this help");
+    renderText(50, 320, "ESC - Exit");
+    renderText(50, 360, "Press H again to close help");
     
     glDisable(GL_BLEND);
     glEnable(GL_DEPTH_TEST);
 }
 
-// Enhanced display function
-void display() {
+// Frame profile overlay: percentiles of each section's time per frame over
+// the recorded frames, and the draw work per frame
+void displayProfile() {
+    if (!showProfile) return;
+    
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    fillOverlay(10, 10, 390, 40 + 18 * (PROFILE_SECTION_COUNT + 2));
+    glDisable(GL_BLEND);
+    
+    const float columns[4] = {130, 190, 250, 310};
+    const char* headers[4] = {"p50", "p90", "p99", "max"};
+    char text[64];
+    snprintf(text, sizeof(text), "ms over %d frames", frameProfiler.frames());
+    renderText(20, 30, text);
+    for (int c = 0; c < 4; c++) renderText(columns[c], 30, headers[c]);
+    for (int s = 0; s < PROFILE_SECTION_COUNT; s++) {
+        float y = 48 + 18 * s;
+        FrameProfiler::Percentiles p = frameProfiler.percentiles((ProfileSection)s);
+        renderText(20, y, profileSectionNames[s]);
+        if (p.samples == 0) continue;
+        const double values[4] = {p.p50, p.p90, p.p99, p.max};
+        for (int c = 0; c < 4; c++) {
+            snprintf(text, sizeof(text), "%.2f", values[c]);
+            renderText(columns[c], y, text);
+        }
+    }
+    snprintf(text, sizeof(text), "%.1f draw calls, %.0f vertices per frame",
+             frameProfiler.averageCount(PROFILE_DRAW_CALLS), frameProfiler.averageCount(PROFILE_VERTICES));
+    renderText(20, 48 + 18 * PROFILE_SECTION_COUNT + 6, text);
+    glEnable(GL_DEPTH_TEST);
+}
+
+// Replay progress, along the bottom of the window
+void displayReplay() {
+    if (!replaying) return;
+    char text[64];
+    snprintf(text, sizeof(text), "Replay: move %llu / %llu", (unsigned long long)replayPosition(),
+             (unsigned long long)replayLog.moveCount());
+    glDisable(GL_DEPTH_TEST);
+    renderText(20, windowHeight - 20, text);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void writeProfile() {
+    if (frameProfiler.dump(profilePath)) printf("Wrote %d frames to %s\n", frameProfiler.frames(), profilePath);
+    else fprintf(stderr, "Cannot write %s\n", profilePath);
+}
+
+// Whether anything on screen still changes without input
+bool animating() {
+    return autoRotate || !moveQueue.idle() || showWall || (replaying && replayNext <= replayLog.moveCount()) ||
+           fabs(camera.targetAngleX - camera.angleX) > 0.1f ||
+           fabs(camera.targetAngleY - camera.angleY) > 0.1f;
+}
+
+// Idle function for smooth animations
+void idle() {
+    glutPostRedisplay();
+}
+
+// Enhanced display function: one frame, timed as a whole
+void drawFrame() {
+    ProfileTimer timer(PROFILE_DISPLAY);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glLoadIdentity();
     
-    // Smooth camera interpolation
+    // Animations advance by elapsed time, not by frame
+    MoveScheduler::Clock::time_point now = MoveScheduler::Clock::now();
+    float dt = std::min(std::chrono::duration<float>(now - lastFrame).count(), 0.1f);
+    lastFrame = now;
+    
+    // Smooth camera interpolation, closing 10% of the gap per 60 Hz frame
     if (camera.smoothRotation) {
-        camera.angleX += (camera.targetAngleX - camera.angleX) * 0.1f;
-        camera.angleY += (camera.targetAngleY - camera.angleY) * 0.1f;
+        float follow = 1.0f - powf(0.9f, dt * 60.0f);
+        camera.angleX += (camera.targetAngleX - camera.angleX) * follow;
+        camera.angleY += (camera.targetAngleY - camera.angleY) * follow;
     }
     
     // Auto rotation
     if (autoRotate) {
-        camera.targetAngleY += 0.5f;
+        camera.targetAngleY += 30.0f * dt;
     }
     
-    // Position camera
-    glTranslatef(0.0f, 0.0f, -camera.distance);
-    glRotatef(camera.angleX, 1.0f, 0.0f, 0.0f);
-    glRotatef(camera.angleY, 0.0f, 1.0f, 0.0f);
-    
-    // Update face rotation animation
-    if (faceRotation.isRotating) {
-        float diff = faceRotation.targetAngle - faceRotation.angle;
-        if (fabs(diff) > 0.1f) {
-            faceRotation.angle += diff * 0.15f;
+    applyCamera(camera.angleX, camera.angleY, camera.distance);
+    
+    // Apply face turns whose animation has finished
+    {
+        ProfileTimer turnTimer(PROFILE_FACE_TURNS);
+        if (cubeSize == 3) {
+            appliedMoves.clear();
+            moveQueue.advance(cube, now, &appliedMoves);
+            recorder.push(appliedMoves.data(), appliedMoves.size());
+            if (!appliedMoves.empty()) recorded();
+            advanceReplay();
         } else {
-            faceRotation.angle = faceRotation.targetAngle;
-            faceRotation.isRotating = false;
-            performFaceRotation(faceRotation.face); // <-- apply logic AFTER animation
+            moveQueue.advance(bigCube, now);
         }
-        glutPostRedisplay();
     }
     
-    setupLighting();
-    drawRubiksCube();
+    positionLights();
+    if (showWall) {
+        drawWall();
+    } else {
+        drawRubiksCube();
+    }
     
+    displayProfile();
+    displayReplay();
     displayHelp();
     
     glutSwapBuffers();
 }
 
+void display() {
+    frameProfiler.beginFrame(redrawing);
+    drawFrame();
+    frameProfiler.endFrame();
+    
+    // Stop redrawing from the idle loop once nothing moves; input events
+    // post a redisplay, which turns it back on when needed
+    redrawing = animating();
+    glutIdleFunc(redrawing ? idle : nullptr);
+}
+
 // Enhanced reshape function
 void reshape(int w, int h) {
     windowWidth = w;
     windowHeight = h;
     
-    if (h == 0) h = 1;
-    float ratio = 1.0f * w / h;
-    
-    glViewport(0, 0, w, h);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0, ratio, 1.0, 100.0);
-    glMatrixMode(GL_MODELVIEW);
+    setProjection(w, h);
 }
 
-// Mouse interaction
+// Mouse interaction: a drag that starts on a sticker turns its layer the
+// way the cursor moves, one quarter turn per drag; anywhere else it orbits
+// the camera. Picking is against the cube at rest, as of the last frame.
 int lastMouseX = 0, lastMouseY = 0;
 bool mousePressed = false;
+bool turnDrag = false;
+StickerPick dragPick;
+int dragStartX = 0, dragStartY = 0;
+const int DRAG_TURN_PIXELS = 8;      // how far a drag goes before it turns
+
+PickRay mouseRay(int x, int y) {
+    return cameraRay(camera.angleX, camera.angleY, camera.distance, windowWidth, windowHeight, x + 0.5f, y + 0.5f);
+}
 
 void mouse(int button, int state, int x, int y) {
     if (button == GLUT_LEFT_BUTTON) {
         mousePressed = (state == GLUT_DOWN);
-        lastMouseX = x;
-        lastMouseY = y;
+        lastMouseX = dragStartX = x;
+        lastMouseY = dragStartY = y;
+        turnDrag = mousePressed && !showWall && !replaying && pickSticker(cubeSize, mouseRay(x, y), dragPick);
     }
 }
 
 void mouseMotion(int x, int y) {
-    if (mousePressed) {
+    if (turnDrag) {
+        int dx = x - dragStartX, dy = y - dragStartY;
+        if (dx * dx + dy * dy < DRAG_TURN_PIXELS * DRAG_TURN_PIXELS) return;
+        int move = dragTurn(cubeSize, dragPick, mouseRay(x, y));
+        if (move >= 0) moveQueue.push(move);
+        turnDrag = false;
+        mousePressed = false;
+        glutPostRedisplay();
+    } else if (mousePressed) {
         float deltaX = x - lastMouseX;
         float deltaY = y - lastMouseY;
         
@@ -528,25 +478,37 @@ void keyboard(unsigned char key, int x, int y) {
         case '-': camera.distance += 0.5f; break;
 
         case 'h': case 'H': showHelp = !showHelp; break;
+        case 'g': case 'G': showWall = wallAvailable && !showWall; break;
+
+        // Profiling runs while its overlay is shown, or throughout with
+        // --profile
+        case 'p': case 'P':
+            showProfile = !showProfile;
+            frameProfiler.setEnabled(showProfile || profileOnExit);
+            break;
+        case 'o': case 'O': writeProfile(); break;
 
-        case 'r': case 'R': resetCube(); break;
+        // While a log replays, the cube follows the log alone
+        case 'r': case 'R': if (!replaying) resetCube(); break;
 
         case ' ':
-            scrambleCube();
+            if (!replaying) scrambleCube();
             break;
 
-        // Face rotations: trigger animation
-        case '1': case '2': case '3': case '4': case '5': case '6': {
-            int face = key - '1'; // map '1'-'6' to 0–5
-            if (!faceRotation.isRotating) {
-                faceRotation.face = face;
-                faceRotation.angle = 0.0f;
-                faceRotation.targetAngle = 90.0f;
-                faceRotation.isRotating = true;
-                // Apply logical state update after animation finishes in display()
-            }
+        // Face rotations: queue a clockwise turn; the cube state changes when
+        // its animation finishes
+        case '1': case '2': case '3': case '4': case '5': case '6':
+            if (!replaying) moveQueue.push((key - '1') * 3); // map '1'-'6' to faces 0–5
             break;
-        }
+
+        case 'v': case 'V': if (!replaying) solveCube(); break;
+        case '[': moveQueue.setSpeed(moveQueue.speed() / 1.5); break;
+        case ']': moveQueue.setSpeed(moveQueue.speed() * 1.5); break;
+
+        case ',': seekReplay(-1); break;
+        case '.': seekReplay(1); break;
+        case '<': seekReplay(-100); break;
+        case '>': seekReplay(100); break;
 
         case 27: exit(0); // ESC
     }
@@ -554,34 +516,62 @@ void keyboard(unsigned char key, int x, int y) {
     glutPostRedisplay();
 }
 
-// Idle function for smooth animations
-void idle() {
-    if (autoRotate || faceRotation.isRotating || 
-        fabs(camera.targetAngleX - camera.angleX) > 0.1f ||
-        fabs(camera.targetAngleY - camera.angleY) > 0.1f) {
-        glutPostRedisplay();
-    }
-}
-
 // Enhanced initialization
 void init() {
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_COLOR_MATERIAL);
-    glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
-    glEnable(GL_NORMALIZE);
-    
-    // Enhanced background gradient effect
-    glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
-    
-    // Anti-aliasing
-    glEnable(GL_LINE_SMOOTH);
-    glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-    
+    setupScene();
+    renderer.init(colors, cubeSize);
+    initWall();
     resetCube();
 }
 
 int main(int argc, char** argv) {
     glutInit(&argc, argv);
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) cubeSize = std::max(2, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profilePath = argv[++i];
+            profileOnExit = true;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+        else {
+            printf("Usage: %s [--size N] [--profile FILE] [--record FILE] [--replay FILE]\n", argv[0]);
+            printf("  --profile FILE  record frame timings from the start and write them to FILE at exit\n");
+            printf("  --record FILE   write the session's moves to a replay log (3x3)\n");
+            printf("  --replay FILE   play back a replay log (3x3; not with --record)\n");
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if ((recordPath || replayPath) && cubeSize != 3) {
+        fprintf(stderr, "Replay logs are 3x3 only\n");
+        return 1;
+    }
+    // Playback restores states at every keyframe and seek, which a recorder
+    // would log as jumps; convert logs with rubiks_replay instead
+    if (recordPath && replayPath) {
+        fprintf(stderr, "--record and --replay cannot be used together\n");
+        return 1;
+    }
+    if (replayPath) {
+        if (!replayLog.load(replayPath)) {
+            fprintf(stderr, "Cannot read the move log %s\n", replayPath);
+            return 1;
+        }
+        replaying = true;
+    }
+    if (recordPath) {
+        if (!recorder.create(recordPath, solvedCubeState())) {
+            fprintf(stderr, "Cannot create %s\n", recordPath);
+            return 1;
+        }
+        atexit(closeRecorder);
+    }
+    bigCube = BigCube(cubeSize);
+    if (profileOnExit) {
+        frameProfiler.setEnabled(true);
+        atexit(writeProfile);
+    }
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     glutInitWindowSize(windowWidth, windowHeight);
     glutInitWindowPosition(100, 100);
@@ -597,9 +587,12 @@ int main(int argc, char** argv) {
     glutIdleFunc(idle);
     
     printf("Enhanced Rubik's Cube Controls:\n");
-    printf("WASD - Camera rotation, Mouse - Interactive control\n");
+    printf("WASD - Camera rotation, Mouse - Drag a sticker to turn, elsewhere to orbit\n");
     printf("1-6 - Rotate faces, Space - Scramble, R - Reset\n");
-    printf("H - Help overlay, A - Auto-rotate, +/- - Zoom\n");
+    printf("V - Solve, [ ] - Turn speed\n");
+    printf("H - Help overlay, A - Auto-rotate, +/- - Zoom, G - Cube wall\n");
+    printf("P - Frame profile, O - Write profile to %s\n", profilePath);
+    if (replaying) printf(", . - Replay back/forward a move, < > - 100 moves\n");
     printf("ESC - Exit\n\n");
     
     glutMainLoop();
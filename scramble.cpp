@@ -0,0 +1,134 @@
+#include "scramble.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+
+#include "solver.h"
+#include "thread_pool.h"
+
+// States generated per task by generateScrambles
+const size_t SCRAMBLES_PER_TASK = 4096;
+
+static uint64_t splitMix64(uint64_t& x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+ScrambleRng::ScrambleRng(uint64_t seed) {
+    for (uint64_t& word : s) word = splitMix64(seed);
+}
+
+ScrambleRng& threadScrambleRng() {
+    static std::atomic<uint64_t> threadCounter{0};
+    thread_local ScrambleRng rng([] {
+        std::random_device entropy;
+        uint64_t seed = ((uint64_t)entropy() << 32) ^ entropy();
+        seed ^= std::chrono::steady_clock::now().time_since_epoch().count();
+        return seed + threadCounter.fetch_add(1) * 0x9e3779b97f4a7c15ULL;
+    }());
+    return rng;
+}
+
+// Move choice as a state machine over (last face, whether its axis was just
+// turned twice). Each state lists the moves allowed next and the state each
+// one leads to, so generating a move is one random draw and two table reads
+// with no unpredictable branches. State 0 is the start; state 1 + 2 * face +
+// run is after a turn of face, with run set after two turns on its axis.
+struct ScrambleTables {
+    uint8_t allowed[13];
+    uint8_t move[13][18];
+    uint8_t next[13][18];
+
+    ScrambleTables() {
+        for (int state = 0; state < 13; state++) {
+            int last = state == 0 ? -1 : (state - 1) / 2;
+            bool axisDone = state != 0 && (state - 1) % 2 == 1;
+            int n = 0;
+            for (int face = 0; face < 6; face++) {
+                if (face == last) continue;
+                bool sameAxis = last >= 0 && face / 2 == last / 2;
+                if (sameAxis && axisDone) continue;
+                for (int turns = 0; turns < 3; turns++) {
+                    move[state][n] = face * 3 + turns;
+                    next[state][n] = 1 + 2 * face + (sameAxis ? 1 : 0);
+                    n++;
+                }
+            }
+            allowed[state] = n;
+        }
+    }
+};
+
+static const ScrambleTables scrambleTables;
+
+int randomScramble(ScrambleRng& rng, int* moves, int count) {
+    int state = 0;
+    for (int i = 0; i < count; i++) {
+        int choice = rng.below(scrambleTables.allowed[state]);
+        moves[i] = scrambleTables.move[state][choice];
+        state = scrambleTables.next[state][choice];
+    }
+    return count;
+}
+
+// Shuffle 0..n-1; returns the permutation's parity
+static int randomPermutation(ScrambleRng& rng, uint8_t* p, int n) {
+    int parity = 0;
+    for (int i = 0; i < n; i++) p[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+        int j = rng.below(i + 1);
+        if (j != i) {
+            std::swap(p[i], p[j]);
+            parity ^= 1;
+        }
+    }
+    return parity;
+}
+
+CubeState randomCubeState(ScrambleRng& rng) {
+    initMoveTables();
+    CubieCube c;
+    int cornerParity = randomPermutation(rng, c.cp, 8);
+    int edgeParity = randomPermutation(rng, c.ep, 12);
+    // Corner and edge permutations must have equal parity; swapping two
+    // edges fixes that and keeps the distribution uniform
+    if (cornerParity != edgeParity) std::swap(c.ep[10], c.ep[11]);
+    // The last twist and flip are fixed by the others
+    int twist = 0, flip = 0;
+    for (int i = 0; i < 7; i++) twist += c.co[i] = rng.below(3);
+    c.co[7] = (3 - twist % 3) % 3;
+    for (int i = 0; i < 11; i++) flip += c.eo[i] = rng.below(2);
+    c.eo[11] = flip & 1;
+    return fromCubieCube(c);
+}
+
+std::vector<int> randomStateScramble(ScrambleRng& rng) {
+    initTwoPhase();
+    std::vector<int> solution;
+    solveTwoPhase(randomCubeState(rng), solution);
+    // Undo the solution: reversed order, each turn in the opposite direction
+    std::reverse(solution.begin(), solution.end());
+    for (int& move : solution) move = move / 3 * 3 + (2 - move % 3);
+    return solution;
+}
+
+void generateScrambles(CubeState* states, size_t count, uint64_t seed, int moves, WorkStealingPool* pool) {
+    initMoveTables();
+    if (!pool) pool = &WorkStealingPool::shared();
+    size_t tasks = (count + SCRAMBLES_PER_TASK - 1) / SCRAMBLES_PER_TASK;
+    pool->parallelFor(tasks, [&](size_t t) {
+        uint64_t blockSeed = seed ^ (t * 0xd1b54a32d192ed03ULL);
+        ScrambleRng rng(splitMix64(blockSeed));
+        std::vector<int> sequence(moves);
+        size_t last = std::min(count, (t + 1) * SCRAMBLES_PER_TASK);
+        for (size_t i = t * SCRAMBLES_PER_TASK; i < last; i++) {
+            randomScramble(rng, sequence.data(), moves);
+            states[i] = solvedCubeState();
+            applyMoves(states[i], sequence.data(), moves);
+        }
+    });
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cube.h"
+
+class WorkStealingPool;
+
+// Scramble generation: a small seeded PRNG, move scrambles over all 18 moves
+// without redundant same-axis turns, and uniformly random cube states.
+
+// xoshiro256** seeded through splitmix64. Plain value type, so every thread
+// keeps its own; the same seed always gives the same sequence.
+class ScrambleRng {
+public:
+    explicit ScrambleRng(uint64_t seed = 0);
+
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, n) for small n (multiply-shift; the bias is below 2^-32)
+    uint32_t below(uint32_t n) { return (uint32_t)(((next() >> 32) * n) >> 32); }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    uint64_t s[4];
+};
+
+// The calling thread's generator, seeded once per thread from the system
+// entropy source, so two scrambles in the same second still differ
+ScrambleRng& threadScrambleRng();
+
+// Write count random moves: every face turn is one of the 18 moves, no move
+// turns the face of the move before it, and no move returns to an axis after
+// two turns on it (F B F is two turns of F). Returns count.
+int randomScramble(ScrambleRng& rng, int* moves, int count);
+
+// A state drawn uniformly from all 43 quintillion reachable states
+CubeState randomCubeState(ScrambleRng& rng);
+
+// Move sequence reaching a uniformly random state: the inverse of a two-phase
+// solution, so it is usually 18 to 22 moves. Builds the two-phase tables on
+// first use.
+std::vector<int> randomStateScramble(ScrambleRng& rng);
+
+// Fill count states with random scrambles of length moves on all pool
+// threads. Block b of the output uses a generator seeded with (seed, b), so
+// the result depends only on seed, never on the thread count.
+void generateScrambles(CubeState* states, size_t count, uint64_t seed, int moves = 25,
+                       WorkStealingPool* pool = nullptr);
@@ -0,0 +1,133 @@
+#include "solution_cache.h"
+
+#include "state_hash.h"
+
+SolutionCache::SolutionCache(size_t capacity) {
+    bucketCount = 1;
+    while (bucketCount * BUCKET_WAYS < capacity) bucketCount *= 2;
+    entries.reset(new Entry[bucketCount * BUCKET_WAYS]);
+}
+
+SolutionCache::Counters& SolutionCache::threadCounters() {
+    static std::atomic<unsigned> nextStripe{0};
+    thread_local unsigned stripe = nextStripe.fetch_add(1) % COUNTER_STRIPES;
+    return counters[stripe];
+}
+
+bool SolutionCache::lookup(const CubeState& state, std::vector<int>& solution) {
+    CubeState canonical = state;
+    int symmetry = canonicalize(canonical);
+    uint64_t key = zobristHash(canonical);
+    Entry* bucket = &entries[(key & (bucketCount - 1)) * BUCKET_WAYS];
+    for (int way = 0; way < BUCKET_WAYS; way++) {
+        Entry& entry = bucket[way];
+        uint32_t before = entry.sequence.load(std::memory_order_acquire);
+        if (before & 1 || entry.key.load(std::memory_order_relaxed) != key) continue;
+        uint64_t words[4];
+        for (int w = 0; w < 4; w++) words[w] = entry.moves[w].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != before) continue;
+
+        // Map the canonical state's solution back to this state and check it
+        int length = words[0] & 0xff;
+        if (length > MAX_MOVES) continue;
+        int inverse = inverseSymmetry(symmetry);
+        solution.resize(length);
+        for (int i = 0; i < length; i++) {
+            int move = (words[(i + 1) / 8] >> ((i + 1) % 8 * 8)) & 0xff;
+            solution[i] = symmetryMove(inverse, move % MOVE_COUNT);
+        }
+        CubeState check = state;
+        applyMoves(check, solution.data(), length);
+        if (!isSolved(check)) continue;
+
+        uint32_t now = clock.load(std::memory_order_relaxed);
+        if (entry.lastUse.load(std::memory_order_relaxed) != now) entry.lastUse.store(now, std::memory_order_relaxed);
+        threadCounters().hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    threadCounters().misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void SolutionCache::insert(const CubeState& state, const std::vector<int>& solution) {
+    if (solution.size() > MAX_MOVES) return;
+    CubeState canonical = state;
+    int symmetry = canonicalize(canonical);
+    uint64_t key = zobristHash(canonical);
+    uint64_t words[4] = {solution.size(), 0, 0, 0};
+    for (size_t i = 0; i < solution.size(); i++) {
+        // Store the solution of the canonical state
+        words[(i + 1) / 8] |= (uint64_t)symmetryMove(symmetry, solution[i]) << ((i + 1) % 8 * 8);
+    }
+
+    // Same key, else an empty way, else the least recently used one
+    Entry* bucket = &entries[(key & (bucketCount - 1)) * BUCKET_WAYS];
+    Entry* victim = nullptr;
+    for (int way = 0; way < BUCKET_WAYS && !victim; way++) {
+        if (bucket[way].key.load(std::memory_order_relaxed) == key) victim = &bucket[way];
+    }
+    for (int way = 0; way < BUCKET_WAYS && !victim; way++) {
+        if (bucket[way].key.load(std::memory_order_relaxed) == 0) victim = &bucket[way];
+    }
+    bool evicting = !victim;
+    uint32_t now = clock.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (!victim) {
+        victim = &bucket[0];
+        for (int way = 1; way < BUCKET_WAYS; way++) {
+            // Ages wrap around with the clock, so compare distances from now
+            if (now - bucket[way].lastUse.load(std::memory_order_relaxed) >
+                now - victim->lastUse.load(std::memory_order_relaxed)) {
+                victim = &bucket[way];
+            }
+        }
+    }
+
+    // Take the entry by making its sequence odd; if another writer holds it,
+    // drop this insertion rather than wait
+    uint32_t sequence = victim->sequence.load(std::memory_order_relaxed);
+    if (sequence & 1 || !victim->sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    victim->key.store(key, std::memory_order_relaxed);
+    for (int w = 0; w < 4; w++) victim->moves[w].store(words[w], std::memory_order_relaxed);
+    victim->lastUse.store(now, std::memory_order_relaxed);
+    victim->sequence.store(sequence + 2, std::memory_order_release);
+
+    Counters& counters = threadCounters();
+    counters.insertions.fetch_add(1, std::memory_order_relaxed);
+    if (evicting) counters.evictions.fetch_add(1, std::memory_order_relaxed);
+}
+
+SolutionCache::Stats SolutionCache::stats() const {
+    Stats total;
+    for (const Counters& c : counters) {
+        total.hits += c.hits.load(std::memory_order_relaxed);
+        total.misses += c.misses.load(std::memory_order_relaxed);
+        total.insertions += c.insertions.load(std::memory_order_relaxed);
+        total.evictions += c.evictions.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void SolutionCache::clear() {
+    for (size_t i = 0; i < bucketCount * BUCKET_WAYS; i++) {
+        Entry& entry = entries[i];
+        uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+        if (sequence & 1 || !entry.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+            continue;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.key.store(0, std::memory_order_relaxed);
+        entry.sequence.store(sequence + 2, std::memory_order_release);
+    }
+}
+
+bool solveCached(SolutionCache& cache, const CubeState& state, std::vector<int>& solution,
+                 const std::function<bool(const CubeState&, std::vector<int>&)>& solver) {
+    if (cache.lookup(state, solution)) return true;
+    if (!solver(state, solution)) return false;
+    cache.insert(state, solution);
+    return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "cube.h"
+
+// Fixed-size concurrent cache of solutions, for putting in front of a solver.
+// States are keyed by their canonical hash (state_hash.h), so a state hits on
+// a solution stored for any of its 48 symmetric images; the stored solution
+// is mapped back through the symmetry. Memory is bounded: the table is an
+// array of 4-way buckets, and a full bucket evicts its least recently used
+// entry. Lookups take no locks. Each entry carries a sequence number that is
+// odd while a writer fills it, and a reader that sees it change treats the
+// entry as a miss. Every hit is also checked by applying the solution, so a
+// hash collision can only cost a miss, never a wrong answer. Safe to use from
+// any number of threads; initSymmetries must have run.
+class SolutionCache {
+public:
+    struct Stats {
+        uint64_t hits = 0, misses = 0;
+        uint64_t insertions = 0, evictions = 0;
+    };
+
+    // Room for at least capacity solutions (rounded up to a power of two)
+    explicit SolutionCache(size_t capacity);
+
+    size_t capacity() const { return bucketCount * BUCKET_WAYS; }
+
+    // Fill solution and return true if a solution for the state (or one of
+    // its symmetric images) is cached
+    bool lookup(const CubeState& state, std::vector<int>& solution);
+
+    // Cache a solution of the state; solutions over 31 moves are not cached
+    void insert(const CubeState& state, const std::vector<int>& solution);
+
+    // Totals over all threads; exact once no thread is using the cache
+    Stats stats() const;
+
+    void clear();
+
+private:
+    static const int BUCKET_WAYS = 4;
+    static const int MAX_MOVES = 31;
+    static const int COUNTER_STRIPES = 16;
+
+    // One cache line per entry; key 0 marks an empty entry. moves holds the
+    // length byte and up to 31 moves, 8 per word.
+    struct alignas(64) Entry {
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<uint32_t> lastUse{0};
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> moves[4] = {};
+    };
+
+    // Counters are striped over cache lines by thread, so counting does not
+    // make every worker write the same line
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> hits{0}, misses{0}, insertions{0}, evictions{0};
+    };
+
+    Counters& threadCounters();
+
+    size_t bucketCount;
+    std::unique_ptr<Entry[]> entries;
+    std::atomic<uint32_t> clock{1};     // advanced by insertions; drives LRU
+    Counters counters[COUNTER_STRIPES];
+};
+
+// Look the state up in the cache and run solver on a miss, caching what it
+// returns
+bool solveCached(SolutionCache& cache, const CubeState& state, std::vector<int>& solution,
+                 const std::function<bool(const CubeState&, std::vector<int>&)>& solver);
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cube.h"
+#include "move_log.h"
+#include "solver.h"
+
+// Solve a single scramble given on the command line and report the solution
+// and how long it took.
+
+static void printUsage(const char* program) {
+    printf("Usage: %s [options] <scramble>\n", program);
+    printf("  --optimal      optimal solution (IDA*) instead of two-phase\n");
+    printf("  --parallel     optimal solution searched on all cores\n");
+    printf("  --time S       keep shortening the two-phase solution for S seconds\n");
+    printf("  --record FILE  write the scramble and the solution to a replay log\n");
+}
+
+int main(int argc, char** argv) {
+    enum { TWO_PHASE, OPTIMAL, PARALLEL } solver = TWO_PHASE;
+    TwoPhaseOptions twoPhase;
+    std::string scramble;
+    const char* recordPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--optimal") == 0) solver = OPTIMAL;
+        else if (strcmp(argv[i], "--parallel") == 0) solver = PARALLEL;
+        else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) twoPhase.timeBudget = atof(argv[++i]);
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (argv[i][0] != '-' || argv[i][1] == '\0') scramble += std::string(argv[i]) + " ";
+        else {
+            printUsage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    initMoveTables();
+    const char* p = scramble.c_str();
+    std::vector<int> moves;
+    if (!parseAlgorithm(p, p + scramble.size(), moves)) {
+        fprintf(stderr, "Invalid move at column %d\n", (int)(p - scramble.c_str()) + 1);
+        return 1;
+    }
+    // Slices and rotations leave the centres moved; solve as seen from the
+    // cube's final orientation
+    CubeState state = solvedCubeState();
+    applyMoves(state, moves.data(), moves.size());
+    normalizeCenters(state);
+    Cube cube(state);
+
+    if (solver == TWO_PHASE) initTwoPhase();
+    else initSolver();
+    std::vector<int> solution;
+    auto start = std::chrono::steady_clock::now();
+    bool solved = solver == OPTIMAL ? solve(cube.state(), solution)
+                : solver == PARALLEL ? solveParallel(cube.state(), solution)
+                : solveTwoPhase(cube.state(), solution, twoPhase);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (!solved) {
+        fprintf(stderr, "No solution found\n");
+        return 1;
+    }
+    std::vector<char> text(solution.size() * 3 + 1);
+    int length = formatMoves(solution.data(), solution.size(), text.data());
+    printf("%.*s\n", length, text.data());
+    fprintf(stderr, "%zu moves in %.3f ms\n", solution.size(), elapsed.count() * 1000);
+
+    // The scramble from solved, the re-centring as a jump, then the solution
+    if (recordPath) {
+        MoveLogWriter log;
+        bool ok = log.create(recordPath, solvedCubeState());
+        log.push(moves.data(), moves.size());
+        log.jump(cube.state());
+        log.push(solution.data(), solution.size());
+        if (!log.close() || !ok) {
+            fprintf(stderr, "Cannot write %s\n", recordPath);
+            return 1;
+        }
+    }
+    return 0;
+}
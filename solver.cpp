@@ -0,0 +1,918 @@
+#include "solver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "thread_pool.h"
+
+// Sticker positions of every corner and edge slot, U/D facelet first and the
+// rest clockwise
+const uint8_t cornerFacelet[8][3] = {
+    {44, 18, 2}, {42, 0, 29}, {36, 27, 11}, {38, 9, 20},
+    {47, 8, 24}, {45, 35, 6}, {51, 17, 33}, {53, 26, 15}
+};
+const uint8_t edgeFacelet[12][2] = {
+    {41, 19}, {43, 1}, {39, 28}, {37, 10}, {50, 25}, {46, 7},
+    {48, 34}, {52, 16}, {5, 21}, {3, 32}, {14, 30}, {12, 23}
+};
+
+CubieCube cubieMoves[MOVE_COUNT];
+
+CubieCube solvedCubieCube() {
+    CubieCube c;
+    for (int i = 0; i < 8; i++) { c.cp[i] = i; c.co[i] = 0; }
+    for (int i = 0; i < 12; i++) { c.ep[i] = i; c.eo[i] = 0; }
+    return c;
+}
+
+void multiplyCubie(const CubieCube& a, const CubieCube& b, CubieCube& result) {
+    for (int i = 0; i < 8; i++) {
+        result.cp[i] = a.cp[b.cp[i]];
+        result.co[i] = (a.co[b.cp[i]] + b.co[i]) % 3;
+    }
+    for (int i = 0; i < 12; i++) {
+        result.ep[i] = a.ep[b.ep[i]];
+        result.eo[i] = a.eo[b.ep[i]] ^ b.eo[i];
+    }
+}
+
+static int permutationParity(const uint8_t* p, int n) {
+    int parity = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            if (p[j] < p[i]) parity ^= 1;
+        }
+    }
+    return parity;
+}
+
+bool toCubieCube(const CubeState& state, CubieCube& result) {
+    const uint8_t* s = state.sticker;
+    for (int face = 0; face < 6; face++) {
+        if (s[face * 9 + 4] != face) return false;
+    }
+    int seenCorners = 0, seenEdges = 0, twist = 0, flip = 0;
+    for (int i = 0; i < 8; i++) {
+        int ori = 0;
+        while (ori < 3 && s[cornerFacelet[i][ori]] != 4 && s[cornerFacelet[i][ori]] != 5) ori++;
+        if (ori == 3) return false;
+        int col1 = s[cornerFacelet[i][(ori + 1) % 3]];
+        int col2 = s[cornerFacelet[i][(ori + 2) % 3]];
+        int piece = 0;
+        while (piece < 8 && (cornerFacelet[piece][1] / 9 != col1 || cornerFacelet[piece][2] / 9 != col2)) piece++;
+        if (piece == 8 || s[cornerFacelet[i][ori]] != cornerFacelet[piece][0] / 9) return false;
+        result.cp[i] = piece;
+        result.co[i] = ori;
+        seenCorners |= 1 << piece;
+        twist += ori;
+    }
+    for (int i = 0; i < 12; i++) {
+        int col0 = s[edgeFacelet[i][0]];
+        int col1 = s[edgeFacelet[i][1]];
+        int piece = 0;
+        for (; piece < 12; piece++) {
+            int a = edgeFacelet[piece][0] / 9, b = edgeFacelet[piece][1] / 9;
+            if (a == col0 && b == col1) { result.eo[i] = 0; break; }
+            if (a == col1 && b == col0) { result.eo[i] = 1; break; }
+        }
+        if (piece == 12) return false;
+        result.ep[i] = piece;
+        seenEdges |= 1 << piece;
+        flip += result.eo[i];
+    }
+    return seenCorners == 0xFF && seenEdges == 0xFFF && twist % 3 == 0 && flip % 2 == 0 &&
+           permutationParity(result.cp, 8) == permutationParity(result.ep, 12);
+}
+
+CubeState fromCubieCube(const CubieCube& c) {
+    CubeState state = solvedCubeState();
+    for (int i = 0; i < 8; i++) {
+        for (int k = 0; k < 3; k++) {
+            state.sticker[cornerFacelet[i][(k + c.co[i]) % 3]] = cornerFacelet[c.cp[i]][k] / 9;
+        }
+    }
+    for (int i = 0; i < 12; i++) {
+        for (int k = 0; k < 2; k++) {
+            state.sticker[edgeFacelet[i][(k + c.eo[i]) % 2]] = edgeFacelet[c.ep[i]][k] / 9;
+        }
+    }
+    return state;
+}
+
+// Derive the cubie moves from the sticker move tables
+static void initCubieMoves() {
+    for (int m = 0; m < MOVE_COUNT; m++) {
+        CubeState state = solvedCubeState();
+        applyMove(state, m);
+        toCubieCube(state, cubieMoves[m]);
+    }
+}
+
+// Lehmer code of a permutation of 0..n-1
+static int permutationIndex(const uint8_t* p, int n) {
+    int index = 0;
+    for (int i = 0; i < n; i++) {
+        int smaller = 0;
+        for (int j = i + 1; j < n; j++) {
+            if (p[j] < p[i]) smaller++;
+        }
+        index = index * (n - i) + smaller;
+    }
+    return index;
+}
+
+static void permutationFromIndex(int index, uint8_t* p, int n) {
+    int digits[12];
+    for (int i = n - 1; i >= 0; i--) {
+        digits[i] = index % (n - i);
+        index /= n - i;
+    }
+    int used = 0;
+    for (int i = 0; i < n; i++) {
+        int k = digits[i], v = 0;
+        for (;; v++) {
+            if (used & (1 << v)) continue;
+            if (k-- == 0) break;
+        }
+        p[i] = v;
+        used |= 1 << v;
+    }
+}
+
+static int twistIndex(const uint8_t* co) {
+    int index = 0;
+    for (int i = 0; i < 7; i++) index = index * 3 + co[i];
+    return index;
+}
+
+static void twistFromIndex(int index, uint8_t* co) {
+    int sum = 0;
+    for (int i = 6; i >= 0; i--) {
+        co[i] = index % 3;
+        sum += co[i];
+        index /= 3;
+    }
+    co[7] = (3 - sum % 3) % 3;
+}
+
+// Pattern database: one 4-bit distance per abstract state, 15 = not reached.
+// table points either at data or at a read-only mapping of a table file.
+struct PatternDatabase {
+    const uint8_t* table = nullptr;
+    std::vector<uint8_t> data;
+    size_t entries = 0;
+
+    size_t bytes() const { return (entries + 1) / 2; }
+    int get(size_t i) const { return (table[i >> 1] >> ((i & 1) * 4)) & 0xF; }
+    void set(size_t i, int v) {
+        uint8_t& b = data[i >> 1];
+        b = (b & ~(0xF << ((i & 1) * 4))) | (v << ((i & 1) * 4));
+    }
+};
+
+const int CORNER_PERMS = 40320;    // 8!
+const int CORNER_TWISTS = 2187;    // 3^7
+const size_t CORNER_PDB_SIZE = (size_t)CORNER_PERMS * CORNER_TWISTS;
+const int EDGE_GROUP_PERMS = 665280;   // 12 * 11 * 10 * 9 * 8 * 7
+const size_t EDGE_PDB_SIZE = (size_t)EDGE_GROUP_PERMS * 64;
+
+// Coordinate move tables for the corner database and a (slot, flip) move
+// table for single edges
+uint16_t cornerPermMove[CORNER_PERMS][MOVE_COUNT];
+uint16_t cornerTwistMove[CORNER_TWISTS][MOVE_COUNT];
+uint8_t edgeSlotMove[24][MOVE_COUNT];
+
+PatternDatabase cornerDatabase;
+PatternDatabase edgeDatabase[2];   // edges 0-5 and 6-11
+
+static void initSolverMoveTables() {
+    for (int i = 0; i < CORNER_PERMS; i++) {
+        CubieCube c = solvedCubieCube(), r;
+        permutationFromIndex(i, c.cp, 8);
+        for (int m = 0; m < MOVE_COUNT; m++) {
+            multiplyCubie(c, cubieMoves[m], r);
+            cornerPermMove[i][m] = permutationIndex(r.cp, 8);
+        }
+    }
+    for (int i = 0; i < CORNER_TWISTS; i++) {
+        CubieCube c = solvedCubieCube(), r;
+        twistFromIndex(i, c.co);
+        for (int m = 0; m < MOVE_COUNT; m++) {
+            multiplyCubie(c, cubieMoves[m], r);
+            cornerTwistMove[i][m] = twistIndex(r.co);
+        }
+    }
+    // The edge in slot src ends up in the slot dst with cubieMoves[m].ep[dst] == src
+    for (int m = 0; m < MOVE_COUNT; m++) {
+        for (int dst = 0; dst < 12; dst++) {
+            int src = cubieMoves[m].ep[dst];
+            for (int flip = 0; flip < 2; flip++) {
+                edgeSlotMove[src * 2 + flip][m] = dst * 2 + (flip ^ cubieMoves[m].eo[dst]);
+            }
+        }
+    }
+}
+
+// Index of six tracked edges given their (slot * 2 + flip) values
+static size_t edgeGroupIndex(const uint8_t* slots) {
+    size_t perm = 0;
+    int used = 0, flips = 0;
+    for (int k = 0; k < 6; k++) {
+        int slot = slots[k] >> 1;
+        perm = perm * (12 - k) + slot - __builtin_popcount(used & ((1 << slot) - 1));
+        used |= 1 << slot;
+        flips = flips * 2 + (slots[k] & 1);
+    }
+    return perm * 64 + flips;
+}
+
+static void edgeGroupFromIndex(size_t index, uint8_t* slots) {
+    int flips = index % 64;
+    size_t perm = index / 64;
+    int digits[6];
+    for (int k = 5; k >= 0; k--) {
+        digits[k] = perm % (12 - k);
+        perm /= 12 - k;
+    }
+    int used = 0;
+    for (int k = 0; k < 6; k++) {
+        int slot = 0;
+        for (int n = digits[k];; slot++) {
+            if (used & (1 << slot)) continue;
+            if (n-- == 0) break;
+        }
+        used |= 1 << slot;
+        slots[k] = slot * 2 + ((flips >> (5 - k)) & 1);
+    }
+}
+
+static int cornerNeighbors(size_t index, size_t* out) {
+    int perm = index / CORNER_TWISTS, twist = index % CORNER_TWISTS;
+    for (int m = 0; m < MOVE_COUNT; m++) {
+        out[m] = (size_t)cornerPermMove[perm][m] * CORNER_TWISTS + cornerTwistMove[twist][m];
+    }
+    return MOVE_COUNT;
+}
+
+static int edgeNeighbors(size_t index, size_t* out) {
+    uint8_t slots[6], next[6];
+    edgeGroupFromIndex(index, slots);
+    for (int m = 0; m < MOVE_COUNT; m++) {
+        for (int k = 0; k < 6; k++) next[k] = edgeSlotMove[slots[k]][m];
+        out[m] = edgeGroupIndex(next);
+    }
+    return MOVE_COUNT;
+}
+
+// Breadth-first fill from the solved index. Early levels expand the frontier;
+// once most states are reached it is cheaper to scan the unreached ones and
+// look for a neighbour on the current level.
+static void buildPatternDatabase(PatternDatabase& db, size_t entries, size_t solvedIndex,
+                                 int (*neighbors)(size_t, size_t*)) {
+    db.entries = entries;
+    db.data.assign(db.bytes(), 0xFF);
+    db.table = db.data.data();
+    db.set(solvedIndex, 0);
+    size_t reached = 1;
+    size_t next[MOVE_COUNT];
+    for (int depth = 0; reached < entries && depth < 14; depth++) {
+        size_t before = reached;
+        bool backward = reached > entries / 2;
+        for (size_t i = 0; i < entries; i++) {
+            if (backward) {
+                if (db.get(i) != 15) continue;
+                int count = neighbors(i, next);
+                for (int m = 0; m < count; m++) {
+                    if (db.get(next[m]) == depth) {
+                        db.set(i, depth + 1);
+                        reached++;
+                        break;
+                    }
+                }
+            } else {
+                if (db.get(i) != depth) continue;
+                int count = neighbors(i, next);
+                for (int m = 0; m < count; m++) {
+                    if (db.get(next[m]) == 15) {
+                        db.set(next[m], depth + 1);
+                        reached++;
+                    }
+                }
+            }
+        }
+        if (reached == before) break;
+    }
+}
+
+// Pruning tables are cached on disk so worker processes can map them instead
+// of rebuilding them. A file holds a fixed header followed by the tables back
+// to back; it is mapped read-only and shared, so every process using the same
+// file shares the same physical pages. The version must be bumped whenever
+// the coordinates or move tables change what a table means.
+const uint32_t TABLE_FILE_VERSION = 1;
+const int MAX_FILE_TABLES = 8;
+const size_t TABLE_HEADER_SIZE = 4096;
+
+struct TableFileHeader {
+    char magic[8];                       // "RCTABLES"
+    uint32_t version;
+    uint32_t tableCount;
+    uint64_t entries[MAX_FILE_TABLES];
+    uint64_t checksum;                   // over everything after the header
+};
+
+std::string tableDirectory() {
+    const char* dir = getenv("RUBIKS_TABLE_DIR");
+    return dir && *dir ? dir : ".";
+}
+
+static uint64_t tableChecksum(const uint8_t* p, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 29;
+    }
+    for (; i < n; i++) h = (h ^ p[i]) * 0x100000001B3ULL;
+    return h;
+}
+
+static TableFileHeader makeTableHeader(PatternDatabase* const* tables, int count) {
+    TableFileHeader header = {};
+    memcpy(header.magic, "RCTABLES", 8);
+    header.version = TABLE_FILE_VERSION;
+    header.tableCount = count;
+    for (int t = 0; t < count; t++) header.entries[t] = tables[t]->entries;
+    return header;
+}
+
+// Map a table file and point the tables into it. Fails, leaving the tables
+// untouched, if the file is missing, truncated, from another version or
+// layout, or fails its checksum.
+static bool mapTableFile(const std::string& path, PatternDatabase* const* tables, int count) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    size_t payload = 0;
+    for (int t = 0; t < count; t++) payload += tables[t]->bytes();
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != TABLE_HEADER_SIZE + payload) {
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+    const uint8_t* base = (const uint8_t*)mapping;
+    TableFileHeader header, expected = makeTableHeader(tables, count);
+    memcpy(&header, base, sizeof(header));
+    expected.checksum = header.checksum;
+    if (memcmp(&header, &expected, sizeof(header)) != 0 ||
+        tableChecksum(base + TABLE_HEADER_SIZE, payload) != header.checksum) {
+        munmap(mapping, st.st_size);
+        return false;
+    }
+    const uint8_t* p = base + TABLE_HEADER_SIZE;
+    for (int t = 0; t < count; t++) {
+        tables[t]->table = p;
+        p += tables[t]->bytes();
+    }
+    return true;
+}
+
+// Write the tables next to the final path and rename into place, so a
+// process mapping the file never sees a partial write
+static bool saveTableFile(const std::string& path, PatternDatabase* const* tables, int count) {
+    std::string temp = path + ".tmp." + std::to_string(getpid());
+    FILE* f = fopen(temp.c_str(), "wb");
+    if (!f) return false;
+    TableFileHeader header = makeTableHeader(tables, count);
+    std::vector<uint8_t> payload;
+    for (int t = 0; t < count; t++) {
+        payload.insert(payload.end(), tables[t]->table, tables[t]->table + tables[t]->bytes());
+    }
+    header.checksum = tableChecksum(payload.data(), payload.size());
+    uint8_t block[TABLE_HEADER_SIZE] = {};
+    memcpy(block, &header, sizeof(header));
+    bool ok = fwrite(block, 1, sizeof(block), f) == sizeof(block) &&
+              fwrite(payload.data(), 1, payload.size(), f) == payload.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Map the named table file, or build the tables and write the file when it is
+// missing or stale. Freshly built tables are swapped for the mapping so this
+// process shares pages with the ones that start after it.
+static void loadOrBuildTables(const char* name, PatternDatabase* const* tables, const size_t* entries,
+                              int count, void (*build)()) {
+    for (int t = 0; t < count; t++) tables[t]->entries = entries[t];
+    std::string path = tableDirectory() + "/" + name;
+    if (mapTableFile(path, tables, count)) return;
+    build();
+    if (!saveTableFile(path, tables, count)) {
+        fprintf(stderr, "Could not write pruning tables to %s\n", path.c_str());
+        return;
+    }
+    if (mapTableFile(path, tables, count)) {
+        for (int t = 0; t < count; t++) std::vector<uint8_t>().swap(tables[t]->data);
+    }
+}
+
+// Search node: corner coordinates plus the (slot * 2 + flip) of every edge
+struct SearchNode {
+    int cornerPerm, cornerTwist;
+    uint8_t edgeSlot[12];
+};
+
+static SearchNode makeSearchNode(const CubieCube& c) {
+    SearchNode node;
+    node.cornerPerm = permutationIndex(c.cp, 8);
+    node.cornerTwist = twistIndex(c.co);
+    for (int i = 0; i < 12; i++) {
+        node.edgeSlot[c.ep[i]] = i * 2 + c.eo[i];
+    }
+    return node;
+}
+
+static void applySearchMove(const SearchNode& node, int move, SearchNode& result) {
+    result.cornerPerm = cornerPermMove[node.cornerPerm][move];
+    result.cornerTwist = cornerTwistMove[node.cornerTwist][move];
+    for (int i = 0; i < 12; i++) {
+        result.edgeSlot[i] = edgeSlotMove[node.edgeSlot[i]][move];
+    }
+}
+
+static int cornerDistance(const SearchNode& node) {
+    return cornerDatabase.get((size_t)node.cornerPerm * CORNER_TWISTS + node.cornerTwist);
+}
+
+// Admissible estimate: the largest of the three database distances. The
+// cheap corner lookup runs first so most nodes are cut before the edges
+// are ranked.
+static int heuristic(const SearchNode& node, int limit) {
+    int h = cornerDistance(node);
+    for (int g = 0; g < 2 && h <= limit; g++) {
+        int e = edgeDatabase[g].get(edgeGroupIndex(node.edgeSlot + g * 6));
+        if (e > h) h = e;
+    }
+    return h;
+}
+
+// Cubie moves and coordinate move tables shared by both solvers
+static void initCoordinateTables() {
+    static std::once_flag initialized;
+    std::call_once(initialized, [] {
+        initMoveTables();
+        initCubieMoves();
+        initSolverMoveTables();
+    });
+}
+
+static void buildSolverDatabases() {
+    buildPatternDatabase(cornerDatabase, CORNER_PDB_SIZE, 0, cornerNeighbors);
+    uint8_t solvedSlots[12];
+    for (int i = 0; i < 12; i++) solvedSlots[i] = i * 2;
+    for (int g = 0; g < 2; g++) {
+        // Both groups use the same indexing with their edges renumbered 0-5, so
+        // the second group is built from the same tables
+        buildPatternDatabase(edgeDatabase[g], EDGE_PDB_SIZE, edgeGroupIndex(solvedSlots + g * 6), edgeNeighbors);
+    }
+}
+
+static void buildSolverTables() {
+    initCoordinateTables();
+    PatternDatabase* tables[] = {&cornerDatabase, &edgeDatabase[0], &edgeDatabase[1]};
+    const size_t entries[] = {CORNER_PDB_SIZE, EDGE_PDB_SIZE, EDGE_PDB_SIZE};
+    loadOrBuildTables("optimal.tables", tables, entries, 3, buildSolverDatabases);
+}
+
+void initSolver() {
+    static std::once_flag initialized;
+    std::call_once(initialized, buildSolverTables);
+}
+
+// Turns of the same face are merged, and turns of opposite faces are only
+// searched in one order (F before B, R before L, U before D)
+static bool redundantMove(int lastFace, int face) {
+    return face == lastFace || (lastFace >= 0 && face == (lastFace ^ 1) && face < lastFace);
+}
+
+// Lets a parallel search task give up once a task it must not beat has
+// found a solution: tasks at or past cutoff are abandoned
+struct SearchCancel {
+    const std::atomic<size_t>* cutoff;
+    size_t task;
+
+    bool cancelled() const { return cutoff->load(std::memory_order_relaxed) <= task; }
+};
+
+// Children are estimated before descending, so only nodes inside the
+// bound are ever visited
+static bool idaSearch(const SearchNode& node, int g, int bound, int lastFace, std::vector<int>& path,
+                      const SearchCancel* cancel = nullptr) {
+    SearchNode next;
+    for (int m = 0; m < MOVE_COUNT; m++) {
+        if (redundantMove(lastFace, m / 3)) continue;
+        if (cancel && cancel->cancelled()) return false;
+        applySearchMove(node, m, next);
+        int h = heuristic(next, bound - g - 1);
+        if (g + 1 + h > bound) continue;
+        path.push_back(m);
+        if (h == 0 || idaSearch(next, g + 1, bound, m / 3, path, cancel)) return true;
+        path.pop_back();
+    }
+    return false;
+}
+
+bool solve(const CubeState& state, std::vector<int>& solution, int maxDepth) {
+    initSolver();
+    solution.clear();
+    CubieCube cubie;
+    if (!toCubieCube(state, cubie)) return false;
+    SearchNode root = makeSearchNode(cubie);
+    int h = heuristic(root, maxDepth);
+    if (h == 0) return true;
+    for (int bound = h; bound <= maxDepth; bound++) {
+        if (idaSearch(root, 0, bound, -1, solution)) return true;
+    }
+    return false;
+}
+
+// A subtree root at the split depth and the moves that lead to it
+struct SearchTask {
+    SearchNode node;
+    int lastFace;
+    int moves[8];
+};
+
+// Collect the split-depth nodes inside the bound in the order idaSearch
+// would reach them
+static void collectSearchTasks(const SearchNode& node, int g, int bound, int splitDepth, int lastFace,
+                               int* path, std::vector<SearchTask>& tasks) {
+    if (g == splitDepth) {
+        SearchTask task;
+        task.node = node;
+        task.lastFace = lastFace;
+        memcpy(task.moves, path, g * sizeof(int));
+        tasks.push_back(task);
+        return;
+    }
+    SearchNode next;
+    for (int m = 0; m < MOVE_COUNT; m++) {
+        if (redundantMove(lastFace, m / 3)) continue;
+        applySearchMove(node, m, next);
+        if (g + 1 + heuristic(next, bound - g - 1) > bound) continue;
+        path[g] = m;
+        collectSearchTasks(next, g + 1, bound, splitDepth, m / 3, path, tasks);
+    }
+}
+
+bool solveParallel(const CubeState& state, std::vector<int>& solution,
+                   const ParallelSolveOptions& options) {
+    initSolver();
+    solution.clear();
+    CubieCube cubie;
+    if (!toCubieCube(state, cubie)) return false;
+    SearchNode root = makeSearchNode(cubie);
+    WorkStealingPool& pool = options.pool ? *options.pool : WorkStealingPool::shared();
+    int splitDepth = std::min(std::max(options.splitDepth, 1), 8);
+    int h = heuristic(root, options.maxDepth);
+    if (h == 0) return true;
+    for (int bound = h; bound <= options.maxDepth; bound++) {
+        // Shallow iterations are too small to be worth splitting. Solutions
+        // are never shorter than the bound, so none end above the split depth.
+        if (bound <= splitDepth || pool.size() == 1) {
+            if (idaSearch(root, 0, bound, -1, solution)) return true;
+            continue;
+        }
+        std::vector<SearchTask> tasks;
+        int path[8];
+        collectSearchTasks(root, 0, bound, splitDepth, -1, path, tasks);
+        std::atomic<size_t> cutoff(SIZE_MAX);
+        std::mutex resultLock;
+        size_t bestTask = SIZE_MAX;
+        pool.parallelFor(tasks.size(), [&](size_t t) {
+            SearchCancel cancel = {&cutoff, t};
+            if (cancel.cancelled()) return;
+            const SearchTask& task = tasks[t];
+            std::vector<int> path(task.moves, task.moves + splitDepth);
+            if (!idaSearch(task.node, splitDepth, bound, task.lastFace, path, &cancel)) return;
+            std::lock_guard<std::mutex> lock(resultLock);
+            if (t < bestTask) {
+                bestTask = t;
+                solution = path;
+                cutoff.store(options.deterministic ? t + 1 : 0);
+            }
+        });
+        if (bestTask != SIZE_MAX) return true;
+    }
+    return false;
+}
+
+// Two-phase solver. Phase 1 brings the cube into the subgroup
+// <U, D, R2, L2, F2, B2> (no twisted corners, no flipped edges, UD-slice
+// edges inside the slice) and phase 2 solves it with those moves only.
+// Solutions are not optimal but the first one typically arrives within a
+// few milliseconds.
+
+const int EDGE_FLIPS = 2048;        // 2^11
+const int SLICE_POSITIONS = 495;    // C(12, 4)
+const int SOLVED_SLICE = 494;       // slice edges in slots 8-11
+const int UD_EDGE_PERMS = 40320;    // 8!
+const int SLICE_PERMS = 24;         // 4!
+const int MAX_PHASE2_LENGTH = 12;   // longer phase 2 tails are cheaper to avoid with another phase 1
+const int MAX_TWO_PHASE_LENGTH = 63; // longest solution the search path holds
+const int PHASE2_MOVE_COUNT = 10;
+const int phase2Moves[PHASE2_MOVE_COUNT] = {1, 4, 7, 10, 12, 13, 14, 15, 16, 17};
+
+uint16_t edgeFlipMove[EDGE_FLIPS][MOVE_COUNT];
+uint16_t slicePositionMove[SLICE_POSITIONS][MOVE_COUNT];
+uint16_t udEdgePermMove[UD_EDGE_PERMS][MOVE_COUNT];   // phase 2 moves only
+uint8_t slicePermMove[SLICE_PERMS][MOVE_COUNT];        // phase 2 moves only
+
+PatternDatabase sliceTwistPrune, sliceFlipPrune, twistFlipPrune;   // phase 1
+PatternDatabase sliceCornerPrune, sliceEdgePrune;      // phase 2
+
+static bool isPhase2Move(int move) {
+    return move / 3 >= 4 || move % 3 == 1;
+}
+
+static int flipIndex(const uint8_t* eo) {
+    int index = 0;
+    for (int i = 0; i < 11; i++) index = index * 2 + eo[i];
+    return index;
+}
+
+static void flipFromIndex(int index, uint8_t* eo) {
+    int parity = 0;
+    for (int i = 10; i >= 0; i--) {
+        eo[i] = index & 1;
+        parity ^= eo[i];
+        index >>= 1;
+    }
+    eo[11] = parity;
+}
+
+static int binomial(int n, int k) {
+    if (k < 0 || k > n) return 0;
+    int result = 1;
+    for (int i = 0; i < k; i++) result = result * (n - i) / (i + 1);
+    return result;
+}
+
+// Combination index of the slots holding the four UD-slice edges (8-11)
+static int slicePositionIndex(const uint8_t* ep) {
+    int index = 0, k = 0;
+    for (int slot = 0; slot < 12; slot++) {
+        if (ep[slot] >= 8) index += binomial(slot, ++k);
+    }
+    return index;
+}
+
+static void slicePositionFromIndex(int index, uint8_t* ep) {
+    int k = 4, sliceEdge = 11, otherEdge = 7;
+    for (int slot = 11; slot >= 0; slot--) {
+        if (k > 0 && index >= binomial(slot, k)) {
+            index -= binomial(slot, k--);
+            ep[slot] = sliceEdge--;
+        } else {
+            ep[slot] = otherEdge--;
+        }
+    }
+}
+
+static int slicePermIndex(const uint8_t* ep) {
+    uint8_t p[4];
+    for (int i = 0; i < 4; i++) p[i] = ep[8 + i] - 8;
+    return permutationIndex(p, 4);
+}
+
+static void initTwoPhaseMoveTables() {
+    CubieCube c, r;
+    for (int i = 0; i < EDGE_FLIPS; i++) {
+        c = solvedCubieCube();
+        flipFromIndex(i, c.eo);
+        for (int m = 0; m < MOVE_COUNT; m++) {
+            multiplyCubie(c, cubieMoves[m], r);
+            edgeFlipMove[i][m] = flipIndex(r.eo);
+        }
+    }
+    for (int i = 0; i < SLICE_POSITIONS; i++) {
+        c = solvedCubieCube();
+        slicePositionFromIndex(i, c.ep);
+        for (int m = 0; m < MOVE_COUNT; m++) {
+            multiplyCubie(c, cubieMoves[m], r);
+            slicePositionMove[i][m] = slicePositionIndex(r.ep);
+        }
+    }
+    for (int i = 0; i < UD_EDGE_PERMS; i++) {
+        c = solvedCubieCube();
+        permutationFromIndex(i, c.ep, 8);
+        for (int k = 0; k < PHASE2_MOVE_COUNT; k++) {
+            int m = phase2Moves[k];
+            multiplyCubie(c, cubieMoves[m], r);
+            udEdgePermMove[i][m] = permutationIndex(r.ep, 8);
+        }
+    }
+    for (int i = 0; i < SLICE_PERMS; i++) {
+        c = solvedCubieCube();
+        uint8_t p[4];
+        permutationFromIndex(i, p, 4);
+        for (int k = 0; k < 4; k++) c.ep[8 + k] = 8 + p[k];
+        for (int k = 0; k < PHASE2_MOVE_COUNT; k++) {
+            int m = phase2Moves[k];
+            multiplyCubie(c, cubieMoves[m], r);
+            slicePermMove[i][m] = slicePermIndex(r.ep);
+        }
+    }
+}
+
+static int sliceTwistNeighbors(size_t index, size_t* out) {
+    int slice = index / CORNER_TWISTS, twist = index % CORNER_TWISTS;
+    for (int m = 0; m < MOVE_COUNT; m++) {
+        out[m] = (size_t)slicePositionMove[slice][m] * CORNER_TWISTS + cornerTwistMove[twist][m];
+    }
+    return MOVE_COUNT;
+}
+
+static int sliceFlipNeighbors(size_t index, size_t* out) {
+    int slice = index / EDGE_FLIPS, flip = index % EDGE_FLIPS;
+    for (int m = 0; m < MOVE_COUNT; m++) {
+        out[m] = (size_t)slicePositionMove[slice][m] * EDGE_FLIPS + edgeFlipMove[flip][m];
+    }
+    return MOVE_COUNT;
+}
+
+static int twistFlipNeighbors(size_t index, size_t* out) {
+    int twist = index / EDGE_FLIPS, flip = index % EDGE_FLIPS;
+    for (int m = 0; m < MOVE_COUNT; m++) {
+        out[m] = (size_t)cornerTwistMove[twist][m] * EDGE_FLIPS + edgeFlipMove[flip][m];
+    }
+    return MOVE_COUNT;
+}
+
+static int sliceCornerNeighbors(size_t index, size_t* out) {
+    int slice = index / CORNER_PERMS, perm = index % CORNER_PERMS;
+    for (int k = 0; k < PHASE2_MOVE_COUNT; k++) {
+        int m = phase2Moves[k];
+        out[k] = (size_t)slicePermMove[slice][m] * CORNER_PERMS + cornerPermMove[perm][m];
+    }
+    return PHASE2_MOVE_COUNT;
+}
+
+static int sliceEdgeNeighbors(size_t index, size_t* out) {
+    int slice = index / UD_EDGE_PERMS, perm = index % UD_EDGE_PERMS;
+    for (int k = 0; k < PHASE2_MOVE_COUNT; k++) {
+        int m = phase2Moves[k];
+        out[k] = (size_t)slicePermMove[slice][m] * UD_EDGE_PERMS + udEdgePermMove[perm][m];
+    }
+    return PHASE2_MOVE_COUNT;
+}
+
+static void buildTwoPhaseDatabases() {
+    buildPatternDatabase(sliceTwistPrune, (size_t)SLICE_POSITIONS * CORNER_TWISTS,
+                         (size_t)SOLVED_SLICE * CORNER_TWISTS, sliceTwistNeighbors);
+    buildPatternDatabase(sliceFlipPrune, (size_t)SLICE_POSITIONS * EDGE_FLIPS,
+                         (size_t)SOLVED_SLICE * EDGE_FLIPS, sliceFlipNeighbors);
+    buildPatternDatabase(twistFlipPrune, (size_t)CORNER_TWISTS * EDGE_FLIPS, 0, twistFlipNeighbors);
+    buildPatternDatabase(sliceCornerPrune, (size_t)SLICE_PERMS * CORNER_PERMS, 0, sliceCornerNeighbors);
+    buildPatternDatabase(sliceEdgePrune, (size_t)SLICE_PERMS * UD_EDGE_PERMS, 0, sliceEdgeNeighbors);
+}
+
+static void buildTwoPhaseTables() {
+    initCoordinateTables();
+    initTwoPhaseMoveTables();
+    PatternDatabase* tables[] = {&sliceTwistPrune, &sliceFlipPrune, &twistFlipPrune,
+                                 &sliceCornerPrune, &sliceEdgePrune};
+    const size_t entries[] = {(size_t)SLICE_POSITIONS * CORNER_TWISTS, (size_t)SLICE_POSITIONS * EDGE_FLIPS,
+                              (size_t)CORNER_TWISTS * EDGE_FLIPS, (size_t)SLICE_PERMS * CORNER_PERMS,
+                              (size_t)SLICE_PERMS * UD_EDGE_PERMS};
+    loadOrBuildTables("twophase.tables", tables, entries, 5, buildTwoPhaseDatabases);
+}
+
+void initTwoPhase() {
+    static std::once_flag initialized;
+    std::call_once(initialized, buildTwoPhaseTables);
+}
+
+struct TwoPhaseSearch {
+    const TwoPhaseOptions* options;
+    CubieCube start;
+    std::chrono::steady_clock::time_point startTime;
+    int path[MAX_TWO_PHASE_LENGTH + 1];
+    std::vector<int> best;
+    int bestLength;
+    bool done;
+};
+
+static int phase1Distance(int twist, int flip, int slice) {
+    int a = sliceTwistPrune.get((size_t)slice * CORNER_TWISTS + twist);
+    int b = sliceFlipPrune.get((size_t)slice * EDGE_FLIPS + flip);
+    int c = twistFlipPrune.get((size_t)twist * EDGE_FLIPS + flip);
+    return a > b ? (a > c ? a : c) : (b > c ? b : c);
+}
+
+static int phase2Distance(int cornerPerm, int edgePerm, int slicePerm) {
+    int a = sliceCornerPrune.get((size_t)slicePerm * CORNER_PERMS + cornerPerm);
+    int b = sliceEdgePrune.get((size_t)slicePerm * UD_EDGE_PERMS + edgePerm);
+    return a > b ? a : b;
+}
+
+static bool phase2Search(TwoPhaseSearch& search, int cornerPerm, int edgePerm, int slicePerm,
+                         int depth, int togo, int lastFace) {
+    if (togo == 0) return cornerPerm == 0 && edgePerm == 0 && slicePerm == 0;
+    for (int k = 0; k < PHASE2_MOVE_COUNT; k++) {
+        int m = phase2Moves[k];
+        if (redundantMove(lastFace, m / 3)) continue;
+        int cp = cornerPermMove[cornerPerm][m];
+        int ep = udEdgePermMove[edgePerm][m];
+        int sp = slicePermMove[slicePerm][m];
+        if (phase2Distance(cp, ep, sp) > togo - 1) continue;
+        search.path[depth] = m;
+        if (phase2Search(search, cp, ep, sp, depth + 1, togo - 1, m / 3)) return true;
+    }
+    return false;
+}
+
+// Called on every phase 1 solution: finish it with the shortest phase 2 that
+// still beats the best solution so far
+static void startPhase2(TwoPhaseSearch& search, int length1) {
+    const TwoPhaseOptions& options = *search.options;
+    if (options.timeBudget > 0.0 && !search.best.empty()) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - search.startTime;
+        if (elapsed.count() > options.timeBudget) {
+            search.done = true;
+            return;
+        }
+    }
+    CubieCube c = search.start, r;
+    for (int i = 0; i < length1; i++) {
+        multiplyCubie(c, cubieMoves[search.path[i]], r);
+        c = r;
+    }
+    int cornerPerm = permutationIndex(c.cp, 8);
+    int edgePerm = permutationIndex(c.ep, 8);
+    int slicePerm = slicePermIndex(c.ep);
+    int maxLength2 = std::min(search.bestLength - 1 - length1, MAX_PHASE2_LENGTH);
+    int lastFace = length1 > 0 ? search.path[length1 - 1] / 3 : -1;
+    for (int length2 = phase2Distance(cornerPerm, edgePerm, slicePerm); length2 <= maxLength2; length2++) {
+        if (!phase2Search(search, cornerPerm, edgePerm, slicePerm, length1, length2, lastFace)) continue;
+        search.bestLength = length1 + length2;
+        search.best.assign(search.path, search.path + search.bestLength);
+        if (options.onImproved) options.onImproved(search.best);
+        if (options.timeBudget <= 0.0 || search.bestLength <= options.targetLength) search.done = true;
+        return;
+    }
+}
+
+static void phase1Search(TwoPhaseSearch& search, int twist, int flip, int slice,
+                         int depth, int togo, int lastFace) {
+    if (togo == 0) {
+        // A phase 1 solution ending in a phase 2 move was already tried one level shorter
+        if (depth == 0 || !isPhase2Move(search.path[depth - 1])) startPhase2(search, depth);
+        return;
+    }
+    for (int m = 0; m < MOVE_COUNT && !search.done; m++) {
+        if (redundantMove(lastFace, m / 3)) continue;
+        int t = cornerTwistMove[twist][m];
+        int f = edgeFlipMove[flip][m];
+        int s = slicePositionMove[slice][m];
+        if (phase1Distance(t, f, s) > togo - 1) continue;
+        search.path[depth] = m;
+        phase1Search(search, t, f, s, depth + 1, togo - 1, m / 3);
+    }
+}
+
+bool solveTwoPhase(const CubeState& state, std::vector<int>& solution,
+                   const TwoPhaseOptions& options) {
+    initTwoPhase();
+    solution.clear();
+    TwoPhaseSearch search;
+    if (!toCubieCube(state, search.start)) return false;
+    search.options = &options;
+    search.startTime = std::chrono::steady_clock::now();
+    search.bestLength = std::min(options.maxLength, MAX_TWO_PHASE_LENGTH) + 1;
+    search.done = false;
+    int twist = twistIndex(search.start.co);
+    int flip = flipIndex(search.start.eo);
+    int slice = slicePositionIndex(search.start.ep);
+    for (int length1 = phase1Distance(twist, flip, slice); length1 < search.bestLength && !search.done; length1++) {
+        phase1Search(search, twist, flip, slice, 0, length1, -1);
+    }
+    solution = search.best;
+    return !search.best.empty() || search.bestLength == 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "cube.h"
+
+class WorkStealingPool;
+
+// Solvers over the cube model. Solutions are move lists in the numbering of
+// cube.h. Tables are built (or mapped from disk) on first use and shared by
+// every thread.
+
+// Cubie-level view of the cube used by the solvers: which corner/edge sits in
+// each slot and how it is twisted/flipped. Slots and orientations follow
+// Kociemba's numbering (corners URF UFL ULB UBR DFR DLF DBL DRB, edges UR UF
+// UL UB DR DF DL DB FR FL BL BR).
+struct CubieCube {
+    uint8_t cp[8], co[8];
+    uint8_t ep[12], eo[12];
+};
+
+CubieCube solvedCubieCube();
+
+// Apply b after a
+void multiplyCubie(const CubieCube& a, const CubieCube& b, CubieCube& result);
+
+// Convert a sticker state to cubies. Fails if the stickers do not describe a
+// cube reachable by face turns from solved (centres must also be in place).
+bool toCubieCube(const CubeState& state, CubieCube& result);
+CubeState fromCubieCube(const CubieCube& c);
+
+// Directory for pruning table files, from RUBIKS_TABLE_DIR or the working
+// directory
+std::string tableDirectory();
+
+// Map or build the optimal solver's pattern databases once; safe to call from
+// any thread
+void initSolver();
+
+// Optimal solver: iterative-deepening A* over the cubie model, bounded by the
+// corner and two six-edge pattern databases. Returns false if the state is
+// not a valid cube or needs more than maxDepth moves.
+bool solve(const CubeState& state, std::vector<int>& solution, int maxDepth = 20);
+
+struct ParallelSolveOptions {
+    WorkStealingPool* pool = nullptr;   // defaults to WorkStealingPool::shared()
+    int maxDepth = 20;
+    int splitDepth = 3;                 // depth at which the tree is cut into tasks
+    bool deterministic = false;         // return exactly what solve() returns
+};
+
+// Optimal solver with each IDA* iteration split into subtree tasks on a
+// work-stealing pool. The first solution found cancels every other task; in
+// deterministic mode only later tasks are cancelled and the earliest task's
+// solution wins, which is the one the sequential search finds.
+bool solveParallel(const CubeState& state, std::vector<int>& solution,
+                   const ParallelSolveOptions& options = ParallelSolveOptions());
+
+// Build the two-phase move tables and map or build its pruning tables once;
+// safe to call from any thread
+void initTwoPhase();
+
+struct TwoPhaseOptions {
+    int maxLength = 30;          // longest acceptable solution; at most 63 is used
+    int targetLength = 0;        // stop as soon as a solution this short is found
+    double timeBudget = 0.0;     // seconds spent shortening; 0 returns the first solution
+    std::function<void(const std::vector<int>&)> onImproved;   // called for every shorter solution
+};
+
+// Fast near-optimal solver. Returns the shortest solution found within the
+// options' time budget, or false if the state is not a valid cube.
+bool solveTwoPhase(const CubeState& state, std::vector<int>& solution,
+                   const TwoPhaseOptions& options = TwoPhaseOptions());
@@ -0,0 +1,284 @@
+#include "state_hash.h"
+
+#include <cstring>
+#include <immintrin.h>
+#include <mutex>
+
+#include "scramble.h"
+
+// Constant seed of the Zobrist keys; changing it changes every stored hash
+const uint64_t ZOBRIST_SEED = 0x5275626978436264ULL;
+
+static uint64_t zobristKeys[54][6];
+
+// A face turn moves 20 stickers (the turned face's but the centre, and three
+// on each neighbouring face). For each, movedFrom is its position before the
+// move and moveDelta the change in hash for each colour it may have: the key
+// at its old position XOR the key at its new one. Updating a hash is then 20
+// lookups on the state before the move.
+static uint8_t movedFrom[MOVE_COUNT][20];
+static uint64_t moveDelta[MOVE_COUNT][20][6];
+
+// The same for the other notation moves, which move up to 52 stickers (a
+// rotation): slices 12, wide turns 32. Kept apart so the face-turn tables
+// stay small enough for L1.
+const int OTHER_MOVE_COUNT = NOTATION_MOVE_COUNT - MOVE_COUNT;
+static uint8_t otherMovedCount[OTHER_MOVE_COUNT];
+static uint8_t otherMovedFrom[OTHER_MOVE_COUNT][52];
+static uint64_t otherMoveDelta[OTHER_MOVE_COUNT][52][6];
+
+struct Symmetry {
+    MovePlan plan;              // where each sticker comes from
+    alignas(16) uint8_t recolor[16];   // colour c becomes recolor[c]
+    int inverse;
+    int moves[NOTATION_MOVE_COUNT];     // image of each move
+};
+
+static Symmetry symmetries[SYMMETRY_COUNT];
+
+// Face normals in the model's face order (F B R L U D)
+static const int FACE_NORMAL[6][3] = {
+    {0, 0, 1}, {0, 0, -1}, {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}
+};
+
+// Sticker geometry: the cubie a sticker sits on, from the face's row-by-row
+// layout as seen looking at that face (the layout CubeRenderer draws)
+static void stickerCubie(int face, int pos, int c[3]) {
+    int row = pos / 3 - 1, col = pos % 3 - 1;
+    switch (face) {
+        case 0: c[0] = col;  c[1] = -row; c[2] = 1;    break;
+        case 1: c[0] = -col; c[1] = -row; c[2] = -1;   break;
+        case 2: c[0] = 1;    c[1] = -row; c[2] = -col; break;
+        case 3: c[0] = -1;   c[1] = -row; c[2] = col;  break;
+        case 4: c[0] = col;  c[1] = 1;    c[2] = row;  break;
+        case 5: c[0] = col;  c[1] = -1;   c[2] = -row; break;
+    }
+}
+
+static int faceOfNormal(const int n[3]) {
+    for (int f = 0; f < 6; f++) {
+        if (n[0] == FACE_NORMAL[f][0] && n[1] == FACE_NORMAL[f][1] && n[2] == FACE_NORMAL[f][2]) return f;
+    }
+    return -1;
+}
+
+// Inverse of stickerCubie for a cubie on the given face
+static int stickerIndex(int face, const int c[3]) {
+    int row = 0, col = 0;
+    switch (face) {
+        case 0: row = -c[1]; col = c[0];  break;
+        case 1: row = -c[1]; col = -c[0]; break;
+        case 2: row = -c[1]; col = -c[2]; break;
+        case 3: row = -c[1]; col = c[2];  break;
+        case 4: row = c[2];  col = c[0];  break;
+        case 5: row = -c[2]; col = c[0];  break;
+    }
+    return face * 9 + (row + 1) * 3 + (col + 1);
+}
+
+static void multiply(const int m[3][3], const int v[3], int out[3]) {
+    for (int r = 0; r < 3; r++) out[r] = m[r][0] * v[0] + m[r][1] * v[1] + m[r][2] * v[2];
+}
+
+static void buildSymmetry(Symmetry& sym, const int m[3][3]) {
+    uint8_t index[64];
+    for (int i = 54; i < 64; i++) index[i] = i;
+    memset(sym.recolor, 0, sizeof(sym.recolor));
+    for (int f = 0; f < 6; f++) {
+        int n[3];
+        multiply(m, FACE_NORMAL[f], n);
+        sym.recolor[f] = faceOfNormal(n);
+    }
+    for (int i = 0; i < 54; i++) {
+        int c[3], image[3];
+        stickerCubie(i / 9, i % 9, c);
+        multiply(m, c, image);
+        // Sticker i lands on the image position, so that position reads i
+        index[stickerIndex(sym.recolor[i / 9], image)] = i;
+    }
+    buildMovePlan(sym.plan, index);
+}
+
+static void permuteScalarState(CubeState& state, const MovePlan& plan) {
+    CubeState next;
+    for (int i = 0; i < 64; i++) next.sticker[i] = state.sticker[plan.index[i]];
+    state = next;
+}
+
+static void recolorScalar(CubeState& state, const uint8_t* recolor) {
+    for (int i = 0; i < 54; i++) state.sticker[i] = recolor[state.sticker[i]];
+}
+
+// pshufb looks every sticker up in the 16-byte colour table at once; the
+// padding bytes (colour 0 to pshufb) are cleared again afterwards
+__attribute__((target("ssse3")))
+static void recolorSSSE3(CubeState& state, const uint8_t* recolor) {
+    __m128i table = _mm_load_si128((const __m128i*)recolor);
+    __m128i* p = (__m128i*)state.sticker;
+    for (int o = 0; o < 4; o++) _mm_store_si128(p + o, _mm_shuffle_epi8(table, _mm_load_si128(p + o)));
+    memset(state.sticker + 54, 0, 10);
+}
+
+static void (*recolor)(CubeState& state, const uint8_t* recolor) = recolorScalar;
+
+static int canonicalizeGeneric(CubeState& state) {
+    CubeState best = state;
+    int bestSymmetry = 0;
+    for (int s = 1; s < SYMMETRY_COUNT; s++) {
+        CubeState image = state;
+        moveKernel.permute(&image, 1, symmetries[s].plan);
+        recolor(image, symmetries[s].recolor);
+        if (memcmp(image.sticker, best.sticker, 54) < 0) {
+            best = image;
+            bestSymmetry = s;
+        }
+    }
+    state = best;
+    return bestSymmetry;
+}
+
+// All 48 images stay in registers: one vpermb moves the stickers, one
+// vpshufb recolours them (padding masked to zero), and the first differing
+// byte of the two compare masks decides which image is smaller
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static int canonicalizeAVX512(CubeState& state) {
+    const __mmask64 stickers = (1ULL << 54) - 1;
+    __m512i v = _mm512_load_si512(state.sticker);
+    __m512i best = v;
+    int bestSymmetry = 0;
+    for (int s = 1; s < SYMMETRY_COUNT; s++) {
+        __m512i image = _mm512_maskz_permutexvar_epi8(~0ULL, _mm512_load_si512(symmetries[s].plan.index), v);
+        __m512i table = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128((const __m128i*)symmetries[s].recolor));
+        image = _mm512_maskz_shuffle_epi8(stickers, table, image);
+        uint64_t differ = _mm512_cmpneq_epi8_mask(image, best);
+        uint64_t less = _mm512_cmplt_epu8_mask(image, best);
+        if (differ && (less >> __builtin_ctzll(differ) & 1)) {
+            best = image;
+            bestSymmetry = s;
+        }
+    }
+    _mm512_store_si512(state.sticker, best);
+    return bestSymmetry;
+}
+
+static int (*canonicalizeKernel)(CubeState& state) = canonicalizeGeneric;
+
+static void buildHashTables() {
+    initMoveTables();
+    ScrambleRng rng(ZOBRIST_SEED);
+    for (auto& keys : zobristKeys) {
+        for (uint64_t& key : keys) key = rng.next();
+    }
+    for (int m = 0; m < NOTATION_MOVE_COUNT; m++) {
+        uint8_t* from = m < MOVE_COUNT ? movedFrom[m] : otherMovedFrom[m - MOVE_COUNT];
+        uint64_t (*delta)[6] = m < MOVE_COUNT ? moveDelta[m] : otherMoveDelta[m - MOVE_COUNT];
+        int n = 0;
+        for (int to = 0; to < 54; to++) {
+            if (movePlans[m].index[to] == to) continue;
+            from[n] = movePlans[m].index[to];
+            for (int c = 0; c < 6; c++) delta[n][c] = zobristKeys[from[n]][c] ^ zobristKeys[to][c];
+            n++;
+        }
+        if (m >= MOVE_COUNT) otherMovedCount[m - MOVE_COUNT] = n;
+    }
+
+    // Every signed permutation matrix; the 24 with determinant +1 (the
+    // rotations) come first, in the order they are enumerated
+    static const int perms[6][3] = {{0, 1, 2}, {1, 2, 0}, {2, 0, 1}, {0, 2, 1}, {2, 1, 0}, {1, 0, 2}};
+    int rotations = 0, mirrors = 24;
+    for (int p = 0; p < 6; p++) {
+        for (int signs = 0; signs < 8; signs++) {
+            int m[3][3] = {};
+            int det = p < 3 ? 1 : -1;
+            for (int r = 0; r < 3; r++) {
+                int sign = signs >> r & 1 ? -1 : 1;
+                m[r][perms[p][r]] = sign;
+                det *= sign;
+            }
+            buildSymmetry(symmetries[det > 0 ? rotations++ : mirrors++], m);
+        }
+    }
+
+    // Inverses and move images by their effect on a labelled state
+    CubeState labels = {};
+    for (int i = 0; i < 54; i++) labels.sticker[i] = i;
+    for (int s = 0; s < SYMMETRY_COUNT; s++) {
+        for (int t = 0; t < SYMMETRY_COUNT; t++) {
+            CubeState x = labels;
+            permuteScalarState(x, symmetries[s].plan);
+            permuteScalarState(x, symmetries[t].plan);
+            if (x == labels) symmetries[s].inverse = t;
+        }
+    }
+    for (int s = 0; s < SYMMETRY_COUNT; s++) {
+        for (int m = 0; m < NOTATION_MOVE_COUNT; m++) {
+            // sym(m(x)) = m'(sym(x)), so m' is sym * m * sym^-1 on positions.
+            // The image of a face turn is a face turn, of a slice a slice and
+            // so on; where two notation moves are the same permutation (a
+            // slice named from either side), the first is taken.
+            CubeState x = labels;
+            permuteScalarState(x, symmetries[symmetries[s].inverse].plan);
+            permuteScalarState(x, movePlans[m]);
+            permuteScalarState(x, symmetries[s].plan);
+            for (int k = NOTATION_MOVE_COUNT - 1; k >= 0; k--) {
+                CubeState y = labels;
+                permuteScalarState(y, movePlans[k]);
+                if (x == y) symmetries[s].moves[m] = k;
+            }
+        }
+    }
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) recolor = recolorSSSE3;
+    if (__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw")) {
+        canonicalizeKernel = canonicalizeAVX512;
+    }
+}
+
+void initSymmetries() {
+    static std::once_flag initialized;
+    std::call_once(initialized, buildHashTables);
+}
+
+uint64_t zobristHash(const CubeState& state) {
+    uint64_t hash = 0;
+    for (int i = 0; i < 54; i++) hash ^= zobristKeys[i][state.sticker[i]];
+    return hash;
+}
+
+void applyMoveHashed(CubeState& state, uint64_t& hash, int move) {
+    uint64_t delta = 0;
+    if (move < MOVE_COUNT) {
+        const uint8_t* from = movedFrom[move];
+        for (int k = 0; k < 20; k++) delta ^= moveDelta[move][k][state.sticker[from[k]]];
+    } else {
+        int o = move - MOVE_COUNT;
+        const uint8_t* from = otherMovedFrom[o];
+        for (int k = 0; k < otherMovedCount[o]; k++) delta ^= otherMoveDelta[o][k][state.sticker[from[k]]];
+    }
+    hash ^= delta;
+    applyMove(state, move);
+}
+
+void applySymmetry(CubeState& state, int symmetry) {
+    moveKernel.permute(&state, 1, symmetries[symmetry].plan);
+    recolor(state, symmetries[symmetry].recolor);
+}
+
+int inverseSymmetry(int symmetry) {
+    return symmetries[symmetry].inverse;
+}
+
+int symmetryMove(int symmetry, int move) {
+    return symmetries[symmetry].moves[move];
+}
+
+int canonicalize(CubeState& state) {
+    return canonicalizeKernel(state);
+}
+
+uint64_t canonicalHash(const CubeState& state) {
+    CubeState canonical = state;
+    canonicalize(canonical);
+    return zobristHash(canonical);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cube.h"
+
+// Hashing and symmetry reduction of cube states, for deduplicating states and
+// keying caches and tables. initSymmetries must have run before any of the
+// functions below are used.
+
+// Build the hash keys and symmetry tables once; safe to call from any thread.
+// Calls initMoveTables.
+void initSymmetries();
+
+// Zobrist hash: the XOR of a fixed random key per (sticker position, colour).
+// Keys are generated from a constant seed, so hashes are stable across runs
+// and processes. A face turn changes 20 stickers, so the hash can be carried
+// along with a state and updated per move instead of recomputed.
+uint64_t zobristHash(const CubeState& state);
+
+// Apply a move to a state and update its Zobrist hash to match. Takes any
+// notation move (0 to NOTATION_MOVE_COUNT - 1), as applyMove does.
+void applyMoveHashed(CubeState& state, uint64_t& hash, int move);
+
+// The 48 symmetries of the cube: 24 rotations, each optionally mirrored.
+// Applying a symmetry conjugates the state: every sticker moves to its image
+// under the symmetry and is recoloured with the image of its colour, so the
+// centres stay put and the result is again a reachable state. Symmetry 0 is
+// the identity; 0-23 are the rotations. Like applyMove, these work in place.
+const int SYMMETRY_COUNT = 48;
+
+
+void applySymmetry(CubeState& state, int symmetry);
+
+int inverseSymmetry(int symmetry);
+
+// The image of a move under a symmetry: turning m and then applying sym
+// gives the same state as applying sym and then turning symmetryMove(sym, m).
+// Defined for every notation move; face turns map to face turns.
+int symmetryMove(int symmetry, int move);
+
+// Replace a state by the representative of its symmetry class: the smallest
+// of its 48 images, comparing stickers in CubeState order. States related by
+// any symmetry have the same representative. Returns the symmetry that maps
+// the state to its representative.
+int canonicalize(CubeState& state);
+
+// Zobrist hash of the representative; equal for every state of a class
+uint64_t canonicalHash(const CubeState& state);
@@ -0,0 +1,484 @@
+#include "state_space.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && std::atomic<uint64_t>::is_always_lock_free,
+              "the distance array is written to disk as plain words");
+
+// Coordinates rank one kind of piece within a set of slots that the space's
+// moves keep those pieces in: their permutation, or the twist of all but the
+// last corner, which the others determine. Pieces are named by their home
+// slot (Kociemba's numbering, see CubieCube).
+enum CoordinateKind { CORNER_PERM, CORNER_TWIST, EDGE_PERM };
+
+struct StateSpaceExplorer::Coordinate {
+    CoordinateKind kind;
+    std::vector<int> slots;
+    uint32_t size = 0;
+    std::vector<uint32_t> moves;    // value * move count + move -> value
+};
+
+namespace {
+
+struct SpaceDefinition {
+    const char* name;
+    const char* description;
+    std::vector<int> faces;         // generating faces, numbered as in cube.h
+    bool cornersOnly;               // a 2x2, as the corners of a 3x3
+    std::vector<std::pair<CoordinateKind, std::vector<int>>> coordinates;
+};
+
+// Corner slots URF UFL ULB UBR DFR DLF DBL DRB, edge slots UR UF UL UB DR DF
+// DL DB FR FL BL BR. The 2x2 keeps its DBL corner fixed, so U, R and F turns
+// reach every state. The 3x3 <R,U,F> group (1.7e14 states, 42 TB at two bits
+// a state) is beyond one machine; on the 2x2 it is the whole cube.
+const std::vector<SpaceDefinition>& spaceDefinitions() {
+    static const std::vector<int> ruCorners = {0, 1, 2, 3, 4, 7};
+    static const std::vector<int> rufCorners = {0, 1, 2, 3, 4, 5, 7};
+    static const std::vector<SpaceDefinition> definitions = {
+        {"2x2", "2x2 cube, <R,U,F> with DBL fixed (3,674,160 states)", {2, 4, 0}, true,
+         {{CORNER_PERM, rufCorners}, {CORNER_TWIST, rufCorners}}},
+        {"2x2-ru", "2x2 cube, <R,U> (29,160 states)", {2, 4}, true,
+         {{CORNER_PERM, ruCorners}, {CORNER_TWIST, ruCorners}}},
+        {"ru", "3x3 cube, <R,U> (73,483,200 states)", {2, 4}, false,
+         {{CORNER_PERM, ruCorners}, {CORNER_TWIST, ruCorners}, {EDGE_PERM, {0, 1, 2, 3, 4, 8, 11}}}},
+    };
+    return definitions;
+}
+
+// Lehmer code of a permutation of 0..n-1
+uint32_t permutationIndex(const uint8_t* p, int n) {
+    uint32_t index = 0;
+    for (int i = 0; i < n; i++) {
+        int smaller = 0;
+        for (int j = i + 1; j < n; j++) {
+            if (p[j] < p[i]) smaller++;
+        }
+        index = index * (n - i) + smaller;
+    }
+    return index;
+}
+
+void permutationFromIndex(uint32_t index, uint8_t* p, int n) {
+    int digits[12];
+    for (int i = n - 1; i >= 0; i--) {
+        digits[i] = index % (n - i);
+        index /= n - i;
+    }
+    int used = 0;
+    for (int i = 0; i < n; i++) {
+        int k = digits[i], v = 0;
+        for (;; v++) {
+            if (used & (1 << v)) continue;
+            if (k-- == 0) break;
+        }
+        p[i] = v;
+        used |= 1 << v;
+    }
+}
+
+uint32_t readCoordinate(const StateSpaceExplorer::Coordinate& c, const CubieCube& cube) {
+    int k = c.slots.size();
+    if (c.kind == CORNER_TWIST) {
+        uint32_t index = 0;
+        for (int i = 0; i < k - 1; i++) index = index * 3 + cube.co[c.slots[i]];
+        return index;
+    }
+    const uint8_t* pieces = c.kind == CORNER_PERM ? cube.cp : cube.ep;
+    uint8_t ranks[12];
+    for (int i = 0; i < k; i++) {
+        int rank = 0;
+        while (rank < k && c.slots[rank] != pieces[c.slots[i]]) rank++;
+        ranks[i] = rank;
+    }
+    return permutationIndex(ranks, k);
+}
+
+void writeCoordinate(const StateSpaceExplorer::Coordinate& c, uint32_t index, CubieCube& cube) {
+    int k = c.slots.size();
+    if (c.kind == CORNER_TWIST) {
+        int sum = 0;
+        for (int i = k - 2; i >= 0; i--) {
+            cube.co[c.slots[i]] = index % 3;
+            sum += index % 3;
+            index /= 3;
+        }
+        cube.co[c.slots[k - 1]] = (3 - sum % 3) % 3;
+        return;
+    }
+    uint8_t* pieces = c.kind == CORNER_PERM ? cube.cp : cube.ep;
+    uint8_t ranks[12];
+    permutationFromIndex(index, ranks, k);
+    for (int i = 0; i < k; i++) pieces[c.slots[i]] = c.slots[ranks[i]];
+}
+
+// The 24 orientations of the cube as rotation moves (cube.h numbering)
+void orientationMoves(int orientation, int* out, int& count) {
+    static const int tilts[6][2] = {{-1, -1}, {60, -1}, {61, -1}, {62, -1}, {54, -1}, {56, -1}};   // -, x, x2, x', z, z'
+    count = 0;
+    for (int m : tilts[orientation / 4]) {
+        if (m >= 0) out[count++] = m;
+    }
+    if (orientation % 4) out[count++] = 66 + orientation % 4 - 1;   // y, y2, y'
+}
+
+const uint64_t LOW_BITS = 0x5555555555555555ULL;
+const size_t BLOCK_WORDS = 4096;
+const int MAX_LEVELS = 120;
+
+// Checkpoint file: this header in a 4096-byte block, then the array
+const uint32_t CHECKPOINT_VERSION = 1;
+const size_t CHECKPOINT_HEADER_SIZE = 4096;
+
+struct CheckpointHeader {
+    char magic[8];                      // "RCEXPLOR"
+    uint32_t version;
+    uint32_t quarterTurns;
+    char space[32];
+    uint64_t indexCount;
+    uint32_t levels;
+    uint32_t complete;
+    uint64_t counts[MAX_LEVELS];
+    uint64_t checksum;                  // over the array
+};
+
+uint64_t arrayChecksum(const uint64_t* words, size_t count) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < count; i++) {
+        h = (h ^ words[i]) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+}  // namespace
+
+const std::vector<ExploreSpaceInfo>& exploreSpaces() {
+    static const std::vector<ExploreSpaceInfo> spaces = [] {
+        std::vector<ExploreSpaceInfo> list;
+        for (const SpaceDefinition& d : spaceDefinitions()) list.push_back({d.name, d.description});
+        return list;
+    }();
+    return spaces;
+}
+
+StateSpaceExplorer::StateSpaceExplorer() = default;
+StateSpaceExplorer::~StateSpaceExplorer() = default;
+
+bool StateSpaceExplorer::init(const char* space, bool quarterTurns) {
+    const SpaceDefinition* definition = nullptr;
+    for (const SpaceDefinition& d : spaceDefinitions()) {
+        if (strcmp(d.name, space) == 0) definition = &d;
+    }
+    if (!definition) return false;
+    initMoveTables();
+    snprintf(spaceName, sizeof(spaceName), "%s", definition->name);
+    quarterTurnMetric = quarterTurns;
+    cornersOnly = definition->cornersOnly;
+    moves.clear();
+    for (int face : definition->faces) {
+        for (int turns = 1; turns <= 3; turns++) {
+            if (!quarterTurns || turns != 2) moves.push_back(face * 3 + turns - 1);
+        }
+    }
+
+    // Cubie moves from the sticker move tables, then a move table for
+    // every coordinate
+    std::vector<CubieCube> cubieMoves(moves.size());
+    for (size_t m = 0; m < moves.size(); m++) {
+        CubeState state = solvedCubeState();
+        applyMove(state, moves[m]);
+        toCubieCube(state, cubieMoves[m]);
+    }
+    coordinates.clear();
+    indices = 1;
+    for (const auto& spec : definition->coordinates) {
+        Coordinate c;
+        c.kind = spec.first;
+        c.slots = spec.second;
+        c.size = 1;
+        int k = c.slots.size();
+        for (int i = 1; i <= (c.kind == CORNER_TWIST ? k - 1 : k); i++) c.size *= c.kind == CORNER_TWIST ? 3 : i;
+        c.moves.resize((size_t)c.size * moves.size());
+        for (uint32_t v = 0; v < c.size; v++) {
+            CubieCube cube = solvedCubieCube(), result;
+            writeCoordinate(c, v, cube);
+            for (size_t m = 0; m < moves.size(); m++) {
+                multiplyCubie(cube, cubieMoves[m], result);
+                c.moves[v * moves.size() + m] = readCoordinate(c, result);
+            }
+        }
+        indices *= c.size;
+        coordinates.push_back(std::move(c));
+    }
+    solvedIndex = indexOf(solvedCubieCube());
+    words.reset();
+    counts.clear();
+    finished = false;
+    return true;
+}
+
+uint64_t StateSpaceExplorer::indexOf(const CubieCube& cube) const {
+    uint64_t index = 0;
+    for (const Coordinate& c : coordinates) index = index * c.size + readCoordinate(c, cube);
+    return index;
+}
+
+int StateSpaceExplorer::neighbors(uint64_t index, uint64_t* out) const {
+    uint32_t digits[4];
+    int n = coordinates.size();
+    for (int i = n - 1; i >= 0; i--) {
+        digits[i] = index % coordinates[i].size;
+        index /= coordinates[i].size;
+    }
+    int moveCount = moves.size();
+    for (int m = 0; m < moveCount; m++) {
+        uint64_t next = 0;
+        for (int i = 0; i < n; i++) next = next * coordinates[i].size + coordinates[i].moves[digits[i] * moveCount + m];
+        out[m] = next;
+    }
+    return moveCount;
+}
+
+uint64_t StateSpaceExplorer::reached() const {
+    uint64_t total = 0;
+    for (uint64_t count : counts) total += count;
+    return total;
+}
+
+// Find level depth + 1. Every block is scanned a word at a time: the mask
+// picks out the entries holding the level's value (forward) or unreached
+// (backward), and padding past the last index is never picked.
+uint64_t StateSpaceExplorer::expandLevel(WorkStealingPool& pool, int depth, bool backward) {
+    const uint64_t current = depth % 3, next = (depth + 1) % 3;
+    const uint64_t pattern = current * LOW_BITS;
+    std::atomic<uint64_t> found{0};
+    size_t blocks = (wordCount() + BLOCK_WORDS - 1) / BLOCK_WORDS;
+    pool.parallelFor(blocks, [&](size_t b) {
+        uint64_t neighbor[18];
+        uint64_t local = 0;
+        size_t end = std::min(wordCount(), (b + 1) * BLOCK_WORDS);
+        for (size_t w = b * BLOCK_WORDS; w < end; w++) {
+            uint64_t word = words[w].load(std::memory_order_relaxed);
+            uint64_t picked;
+            if (backward) {
+                picked = word & (word >> 1) & LOW_BITS;
+            } else {
+                uint64_t x = word ^ pattern;
+                picked = ~(x | (x >> 1)) & LOW_BITS;
+            }
+            if (w == wordCount() - 1 && indices % 32) picked &= (1ULL << (indices % 32 * 2)) - 1;
+            for (; picked; picked &= picked - 1) {
+                uint64_t index = w * 32 + __builtin_ctzll(picked) / 2;
+                int count = neighbors(index, neighbor);
+                if (backward) {
+                    for (int m = 0; m < count; m++) {
+                        if ((uint64_t)value(neighbor[m]) != current) continue;
+                        // Only this task writes the entry, but others read
+                        // and claim in the same word
+                        words[w].fetch_and(~((3 ^ next) << (index % 32 * 2)), std::memory_order_relaxed);
+                        local++;
+                        break;
+                    }
+                } else {
+                    for (int m = 0; m < count; m++) {
+                        uint64_t n = neighbor[m];
+                        int shift = n % 32 * 2;
+                        if (value(n) != 3) continue;
+                        uint64_t old = words[n / 32].fetch_and(~((3 ^ next) << shift), std::memory_order_relaxed);
+                        if (((old >> shift) & 3) == 3) local++;
+                    }
+                }
+            }
+        }
+        found.fetch_add(local, std::memory_order_relaxed);
+    });
+    return found.load();
+}
+
+bool StateSpaceExplorer::run(const ExploreOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    WorkStealingPool& pool = options.pool ? *options.pool : WorkStealingPool::shared();
+    if (!words) {
+        words.reset(new (std::nothrow) std::atomic<uint64_t>[wordCount()]);
+        if (!words) {
+            fprintf(stderr, "Cannot allocate %zu MB for %llu states\n", memoryBytes() >> 20,
+                    (unsigned long long)indices);
+            return false;
+        }
+        counts.clear();
+    }
+    int loaded = options.checkpoint ? loadCheckpoint(options.checkpoint) : 0;
+    if (loaded < 0) return false;
+    if (loaded == 0 && counts.empty()) {
+        size_t blocks = (wordCount() + BLOCK_WORDS - 1) / BLOCK_WORDS;
+        pool.parallelFor(blocks, [&](size_t b) {
+            size_t end = std::min(wordCount(), (b + 1) * BLOCK_WORDS);
+            for (size_t w = b * BLOCK_WORDS; w < end; w++) words[w].store(~0ULL, std::memory_order_relaxed);
+        });
+        words[solvedIndex / 32].fetch_and(~(3ULL << (solvedIndex % 32 * 2)));
+        counts.assign(1, 1);
+        finished = false;
+    }
+
+    Clock::time_point lastSave = Clock::now();
+    while (!finished) {
+        Clock::time_point start = Clock::now();
+        int depth = counts.size() - 1;
+        bool backward = indices - reached() < counts.back();
+        uint64_t found = expandLevel(pool, depth, backward);
+        if (found == 0 || (int)counts.size() == MAX_LEVELS) {
+            finished = true;
+        } else {
+            counts.push_back(found);
+            if (options.onLevel) {
+                options.onLevel(depth + 1, found, backward,
+                                std::chrono::duration<double>(Clock::now() - start).count());
+            }
+        }
+        if (options.checkpoint &&
+            (finished || std::chrono::duration<double>(Clock::now() - lastSave).count() >= options.checkpointSeconds)) {
+            if (!saveCheckpoint(options.checkpoint)) {
+                fprintf(stderr, "Could not write checkpoint %s\n", options.checkpoint);
+            }
+            lastSave = Clock::now();
+        }
+    }
+    return true;
+}
+
+// 1 if the file held this space and was loaded, 0 if there is none, -1 if it
+// is another run's or damaged
+int StateSpaceExplorer::loadCheckpoint(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    CheckpointHeader header;
+    uint8_t block[CHECKPOINT_HEADER_SIZE];
+    bool ok = fread(block, 1, sizeof(block), f) == sizeof(block);
+    memcpy(&header, block, sizeof(header));
+    ok = ok && memcmp(header.magic, "RCEXPLOR", 8) == 0 && header.version == CHECKPOINT_VERSION &&
+         strncmp(header.space, spaceName, sizeof(header.space)) == 0 &&
+         header.quarterTurns == (uint32_t)quarterTurnMetric && header.indexCount == indices &&
+         header.levels >= 1 && header.levels <= (uint32_t)MAX_LEVELS;
+    if (!ok) {
+        fclose(f);
+        fprintf(stderr, "%s is not a checkpoint of %s in the %s metric\n", path, spaceName,
+                quarterTurnMetric ? "quarter-turn" : "half-turn");
+        return -1;
+    }
+    uint64_t* array = reinterpret_cast<uint64_t*>(words.get());
+    ok = fread(array, sizeof(uint64_t), wordCount(), f) == wordCount() && fgetc(f) == EOF &&
+         arrayChecksum(array, wordCount()) == header.checksum;
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "Checkpoint %s is damaged\n", path);
+        counts.clear();
+        return -1;
+    }
+    counts.assign(header.counts, header.counts + header.levels);
+    finished = header.complete != 0;
+    return 1;
+}
+
+// Write next to the final path and rename into place, so a run stopped
+// mid-write keeps its previous checkpoint
+bool StateSpaceExplorer::saveCheckpoint(const char* path) const {
+    std::string temp = std::string(path) + ".tmp." + std::to_string(getpid());
+    FILE* f = fopen(temp.c_str(), "wb");
+    if (!f) return false;
+    const uint64_t* array = reinterpret_cast<const uint64_t*>(words.get());
+    CheckpointHeader header = {};
+    memcpy(header.magic, "RCEXPLOR", 8);
+    header.version = CHECKPOINT_VERSION;
+    header.quarterTurns = quarterTurnMetric;
+    memcpy(header.space, spaceName, sizeof(header.space));
+    header.indexCount = indices;
+    header.levels = counts.size();
+    header.complete = finished;
+    std::copy(counts.begin(), counts.end(), header.counts);
+    header.checksum = arrayChecksum(array, wordCount());
+    uint8_t block[CHECKPOINT_HEADER_SIZE] = {};
+    memcpy(block, &header, sizeof(header));
+    bool ok = fwrite(block, 1, sizeof(block), f) == sizeof(block) &&
+              fwrite(array, sizeof(uint64_t), wordCount(), f) == wordCount();
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path) != 0) {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Pieces outside the coordinates must be home, and untwisted or unflipped
+// unless a coordinate tracks that; the array then tells whether the rest is
+// reachable
+bool StateSpaceExplorer::inSpace(const CubieCube& cube) const {
+    int trackedCorners = 0, trackedEdges = 0;
+    bool twists = false;
+    for (const Coordinate& c : coordinates) {
+        for (int slot : c.slots) {
+            if (c.kind == CORNER_PERM) trackedCorners |= 1 << slot;
+            if (c.kind == EDGE_PERM) trackedEdges |= 1 << slot;
+        }
+        if (c.kind == CORNER_TWIST) twists = true;
+    }
+    for (int i = 0; i < 8; i++) {
+        if (!(trackedCorners & (1 << i)) && cube.cp[i] != i) return false;
+        if ((!twists || !(trackedCorners & (1 << i))) && cube.co[i] != 0) return false;
+    }
+    if (cornersOnly) return true;
+    for (int i = 0; i < 12; i++) {
+        if ((!(trackedEdges & (1 << i)) && cube.ep[i] != i) || cube.eo[i] != 0) return false;
+    }
+    return true;
+}
+
+int StateSpaceExplorer::distance(const CubeState& state) const {
+    if (!finished) return -1;
+    // A 2x2 has no centres to go by: try every orientation for the one that
+    // puts the DBL corner home, with edges and centres taken as solved
+    uint64_t index = indices;
+    for (int orientation = 0; orientation < (cornersOnly ? 24 : 1) && index == indices; orientation++) {
+        CubeState s = state;
+        int rotation[3], count;
+        orientationMoves(orientation, rotation, count);
+        applyMoves(s, rotation, count);
+        if (cornersOnly) {
+            for (int i = 0; i < 54; i++) {
+                if (i % 9 % 2 == 1 || i % 9 == 4) s.sticker[i] = i / 9;
+            }
+        } else {
+            normalizeCenters(s);
+        }
+        CubieCube cube;
+        bool valid = toCubieCube(s, cube);
+        if (!valid && cornersOnly) {
+            // An odd corner permutation takes two swapped edges to make a cube
+            std::swap(s.sticker[1], s.sticker[19]);
+            valid = toCubieCube(s, cube);
+        }
+        if (valid && inSpace(cube)) index = indexOf(cube);
+    }
+    if (index == indices || value(index) == 3) return -1;
+    // Walk down a level at a time: of a state's neighbours, only those one
+    // level closer hold its value minus one, mod 3
+    uint64_t neighbor[18];
+    int d = 0;
+    while (index != solvedIndex && d < MAX_LEVELS) {
+        int down = (value(index) + 2) % 3, count = neighbors(index, neighbor);
+        int m = 0;
+        while (m < count && value(neighbor[m]) != down) m++;
+        if (m == count) return -1;
+        index = neighbor[m];
+        d++;
+    }
+    return d;
+}
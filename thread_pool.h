@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool for data-parallel loops. Each worker owns a deque of
+// task indices and takes from its front; a worker that runs dry steals from
+// the back of another's, so uneven tasks still keep every thread busy. The
+// calling thread works as worker 0.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int threads = 0) {
+        if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        queues = std::vector<TaskQueue>(threads);
+        for (int w = 1; w < threads; w++) {
+            workers.emplace_back([this, w] { workerLoop(w); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(jobLock);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (std::thread& t : workers) t.join();
+    }
+
+    int size() const { return (int)queues.size(); }
+
+    // Run body(i) for every i in [0, count) and wait for all of them. Indices
+    // are dealt round-robin, so lower indices tend to run first.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body) {
+        std::lock_guard<std::mutex> serial(runLock);
+        for (size_t i = 0; i < count; i++) {
+            queues[i % queues.size()].items.push_back(i);
+        }
+        {
+            std::lock_guard<std::mutex> lock(jobLock);
+            job = &body;
+            busyWorkers = (int)workers.size();
+            generation++;
+        }
+        jobReady.notify_all();
+        drain(0, body);
+        std::unique_lock<std::mutex> lock(jobLock);
+        jobDone.wait(lock, [this] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+    // Pool shared by the library's parallel entry points
+    static WorkStealingPool& shared() {
+        static WorkStealingPool pool;
+        return pool;
+    }
+
+private:
+    struct TaskQueue {
+        std::mutex lock;
+        std::deque<size_t> items;
+
+        TaskQueue() = default;
+        TaskQueue(const TaskQueue&) {}
+    };
+
+    bool take(int w, size_t& task) {
+        for (size_t k = 0; k < queues.size(); k++) {
+            TaskQueue& q = queues[(w + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.lock);
+            if (q.items.empty()) continue;
+            if (k == 0) {
+                task = q.items.front();
+                q.items.pop_front();
+            } else {
+                task = q.items.back();
+                q.items.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // No tasks are added while a job runs, so a worker that finds every
+    // queue empty is finished with it
+    void drain(int w, const std::function<void(size_t)>& body) {
+        size_t task;
+        while (take(w, task)) {
+            body(task);
+        }
+    }
+
+    void workerLoop(int w) {
+        uint64_t seen = 0;
+        for (;;) {
+            const std::function<void(size_t)>* body;
+            {
+                std::unique_lock<std::mutex> lock(jobLock);
+                jobReady.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                body = job;
+            }
+            drain(w, *body);
+            std::lock_guard<std::mutex> lock(jobLock);
+            if (--busyWorkers == 0) jobDone.notify_all();
+        }
+    }
+
+    std::vector<TaskQueue> queues;
+    std::vector<std::thread> workers;
+    std::mutex runLock, jobLock;
+    std::condition_variable jobReady, jobDone;
+    const std::function<void(size_t)>* job = nullptr;
+    uint64_t generation = 0;
+    int busyWorkers = 0;
+    bool stopping = false;
+};
+